@@ -2,52 +2,15 @@
 #include <vector>
 #include <random>
 #include <algorithm>
-#include <chrono>
-#include <fstream>
 #include <string>
 #include <map>
+#include <cstdint>
 
-class ArrayGenerator {
-public:
-    std::random_device rd;
-    std::mt19937 gen;
-
-    ArrayGenerator() : gen(rd()) {}
-
-    std::vector<double> generateRandomArray(int size) {
-        std::vector<double> arr(size);
-        std::uniform_real_distribution<> dist(0, 6000);
-        for (int i = 0; i < size; i++) {
-            arr[i] = dist(gen);
-        }
-        return arr;
-    }
-
-    std::vector<double> generateReversedSortedArray(int size) {
-        std::vector<double> arr(size);
-        double value = 6000;
-        for (int i = 0; i < size; i++) {
-            arr[i] = value;
-            value -= 6000.0 / size;
-        }
-        return arr;
-    }
-
-    std::vector<double> generateAlmostSortedArray(int size) {
-        std::vector<double> arr(size);
-        for (int i = 0; i < size; i++) {
-            arr[i] = i;
-        }
-        int swapNum = size * 0.01;
-        std::uniform_int_distribution<int> dist(0, size - 1);
-        for (int i = 0; i < swapNum; i++) {
-            int j = dist(gen);
-            int k = dist(gen);
-            std::swap(arr[j], arr[k]);
-        }
-        return arr;
-    }
-};
+#define SORT_BENCH_COUNT_ALLOCATIONS
+#include "../common/ArrayGenerator.h"
+#include "../common/BenchmarkInputs.h"
+#include "../common/SortBenchmark.h"
+#include "../common/SortingNetworks.h"
 
 void merge(std::vector<double>& arr, int left, int mid, int right) {
     int n1 = mid - left + 1;
@@ -108,8 +71,13 @@ void insertionSort(std::vector<double>& arr, int left, int right) {
 void hybridMergeSort(std::vector<double>& arr, int left, int right, int threshold) {
     if (left >= right) return;
 
-    if (right - left + 1 <= threshold) {
-        insertionSort(arr, left, right);
+    int n = right - left + 1;
+    if (n <= threshold) {
+        if (n <= kMaxNetworkSize) {
+            networkSort(arr.data() + left, n);
+        } else {
+            insertionSort(arr, left, right);
+        }
         return;
     }
 
@@ -119,95 +87,87 @@ void hybridMergeSort(std::vector<double>& arr, int left, int right, int threshol
     merge(arr, left, mid, right);
 }
 
-class SortTester {
-public:
-    static double testMergeSort(std::vector<double> arr) {
-        auto start = std::chrono::high_resolution_clock::now();
-        mergeSort(arr, 0, arr.size() - 1);
-        auto end = std::chrono::high_resolution_clock::now();
-        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    }
-
-    static double testHybridMergeSort(std::vector<double> arr, int threshold) {
-        auto start = std::chrono::high_resolution_clock::now();
-        hybridMergeSort(arr, 0, arr.size() - 1, threshold);
-        auto end = std::chrono::high_resolution_clock::now();
-        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    }
-};
-
-void writeToCSV(const std::string& filename, const std::vector<std::vector<std::string>>& data) {
-    std::ofstream file(filename);
-    for (const auto& row : data) {
-        for (size_t i = 0; i < row.size(); ++i) {
-            file << row[i];
-            if (i != row.size() - 1) file << ",";
+int main(int argc, char** argv) {
+    const int MAX_SIZE = 100000;
+    int optimalThreshold = kMaxNetworkSize;
+
+    const char* usage =
+        "Usage: a1 [--csv | --json] [--seed N] [replay.bin]\n"
+        "       a1 --convert results.bin results.csv\n";
+    ResultFormat format = ResultFormat::Binary;
+    std::string replayPath;
+    std::uint64_t seed = std::random_device{}();
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--csv") {
+            format = ResultFormat::CSV;
+        } else if (arg == "--json") {
+            format = ResultFormat::JSON;
+        } else if (arg == "--convert") {
+            if (i + 2 >= argc) {
+                std::cerr << usage;
+                return 1;
+            }
+            convertResultsToCSV(argv[i + 1], argv[i + 2]);
+            std::cout << "Converted " << argv[i + 1] << " to " << argv[i + 2] << std::endl;
+            return 0;
+        } else if (arg == "--seed") {
+            if (i + 1 >= argc) {
+                std::cerr << usage;
+                return 1;
+            }
+            seed = std::stoull(argv[++i]);
+        } else if (arg.rfind("--", 0) == 0 || !replayPath.empty()) {
+            std::cerr << usage;
+            return 1;
+        } else {
+            replayPath = arg;
         }
-        file << "\n";
     }
-    file.close();
-}
-
-
-int main() {
-    ArrayGenerator testGenerator;
-    const int REPEATS = 5;
-    const int MAX_SIZE = 100000;
-    int optimalThreshold = 50;
 
-    std::vector<double> bigRandomArray = testGenerator.generateRandomArray(MAX_SIZE);
-    std::vector<double> bigReversedArray = testGenerator.generateReversedSortedArray(MAX_SIZE);
-    std::vector<double> bigAlmostSortedArray = testGenerator.generateAlmostSortedArray(MAX_SIZE);
-
-    std::vector<std::vector<std::string>> csvData;
-    csvData.push_back({"Size", "DataType", "Algorithm", "TimeMicroseconds"});
+    checkSortingNetworks();
+    ArrayGenerator testGenerator(seed);
+    std::cout << "Input seed: " << seed << " (rerun with --seed " << seed << ")" << std::endl;
+    std::string resultsFile = std::string("sorting_results") +
+        (format == ResultFormat::Binary ? ".bin" : format == ResultFormat::CSV ? ".csv" : ".json");
+
+    BenchmarkInputs inputs = prepareBenchmarkInputs("sorting_inputs.bin", MAX_SIZE,
+                                                    testGenerator, replayPath);
+    SortBenchmark benchmark;
+    ResultStream results(resultsFile, format, testGenerator.seed());
+
+    auto plainSort = [](std::vector<double>& arr) {
+        mergeSort(arr, 0, (int)arr.size() - 1);
+    };
+    auto hybridSort = [optimalThreshold](std::vector<double>& arr) {
+        hybridMergeSort(arr, 0, (int)arr.size() - 1, optimalThreshold);
+    };
+
+    // A sort that loses or duplicates elements would still be timed, so each
+    // one is checked once per profile at full size first.
+    for (int profile = 0; profile < inputs.profileCount(); profile++) {
+        const std::string& dataType = inputs.profileName(profile);
+        benchmark.verifySort("MergeSort", dataType, inputs.profile(profile), MAX_SIZE, plainSort);
+        benchmark.verifySort("HybridMergeSort", dataType, inputs.profile(profile), MAX_SIZE, hybridSort);
+    }
 
     for (int size = 500; size <= MAX_SIZE; size += 100) {
         std::cout << "Testing size: " << size << std::endl;
-        std::vector<double> randomSlice(bigRandomArray.begin(), bigRandomArray.begin() + size);
-        std::vector<double> reversedSlice(bigReversedArray.begin(), bigReversedArray.begin() + size);
-        std::vector<double> almostSortedSlice(bigAlmostSortedArray.begin(), bigAlmostSortedArray.begin() + size);
-        std::vector<std::pair<std::string, std::vector<double>>> testCases = {
-            {"Random", randomSlice},
-            {"Reversed", reversedSlice},
-            {"AlmostSorted", almostSortedSlice}
-        };
-
-        for (const auto& testCase : testCases) {
-            const std::string& dataType = testCase.first;
-            const std::vector<double>& testArray = testCase.second;
-
-            double totalTime = 0.0;
-            for (int j = 0; j < REPEATS; j++) {
-                std::vector<double> arrCopy = testArray;
-                totalTime += SortTester::testMergeSort(arrCopy);
-            }
-            double averageTime = totalTime / REPEATS;
-            csvData.push_back({
-                std::to_string(size),
-                dataType,
-                "MergeSort",
-                std::to_string(averageTime)
-            });
-
-            double totalHybridTime = 0.0;
-            for (int j = 0; j < REPEATS; j++) {
-                std::vector<double> arrCopy = testArray;
-                totalHybridTime += SortTester::testHybridMergeSort(arrCopy, optimalThreshold);
-            }
-            double averageHybridTime = totalHybridTime / REPEATS;
-            csvData.push_back({
-                std::to_string(size),
-                dataType,
-                "HybridMergeSort",
-                std::to_string(averageHybridTime)
-            });
+
+        for (int profile = 0; profile < inputs.profileCount(); profile++) {
+            const std::string& dataType = inputs.profileName(profile);
+            const double* testArray = inputs.profile(profile);
+
+            results.write(benchmark.run("MergeSort", dataType, testArray, size, plainSort));
+            results.write(benchmark.run("HybridMergeSort", dataType, testArray, size, hybridSort));
         }
     }
-    writeToCSV("sorting_results.csv", csvData);
-    std::cout << "Results saved to sorting_results.csv" << std::endl;
-    std::cout << "Total records: " << csvData.size() - 1 << std::endl;
+    std::cout << "Results saved to " << resultsFile << std::endl;
+    std::cout << "Total records: " << results.count() << std::endl;
     std::cout << "Optimal threshold used: " << optimalThreshold << std::endl;
+    if (!benchmark.hardwareCountersAvailable()) {
+        std::cout << "Hardware counters unavailable, perf columns are -1" << std::endl;
+    }
 
     return 0;
-}
\ No newline at end of file
+}
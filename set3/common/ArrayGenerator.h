@@ -0,0 +1,301 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Input generators for the sorting benchmarks. Large arrays are filled in
+// fixed-size blocks on all cores; every block gets its own engine derived from
+// the generator seed, the profile and the block index, so the output for a
+// given seed does not depend on the number of threads and no two profiles
+// share a random stream.
+
+enum class DataProfile {
+    Random,
+    Reversed,
+    AlmostSorted,
+    Sorted,
+    FewUnique,
+    AllEqual,
+    OrganPipe,
+    Sawtooth,
+    Zipfian,
+    SpecialValues,
+    MedianOf3Killer
+};
+
+inline const char* dataProfileName(DataProfile profile) {
+    switch (profile) {
+        case DataProfile::Random: return "Random";
+        case DataProfile::Reversed: return "Reversed";
+        case DataProfile::AlmostSorted: return "AlmostSorted";
+        case DataProfile::Sorted: return "Sorted";
+        case DataProfile::FewUnique: return "FewUnique";
+        case DataProfile::AllEqual: return "AllEqual";
+        case DataProfile::OrganPipe: return "OrganPipe";
+        case DataProfile::Sawtooth: return "Sawtooth";
+        case DataProfile::Zipfian: return "Zipfian";
+        case DataProfile::SpecialValues: return "SpecialValues";
+        case DataProfile::MedianOf3Killer: return "MedianOf3Killer";
+    }
+    return "Unknown";
+}
+
+inline const std::vector<DataProfile>& allDataProfiles() {
+    static const std::vector<DataProfile> profiles = {
+        DataProfile::Random, DataProfile::Reversed, DataProfile::AlmostSorted,
+        DataProfile::Sorted, DataProfile::FewUnique, DataProfile::AllEqual,
+        DataProfile::OrganPipe, DataProfile::Sawtooth, DataProfile::Zipfian,
+        DataProfile::SpecialValues, DataProfile::MedianOf3Killer
+    };
+    return profiles;
+}
+
+class ArrayGenerator {
+public:
+    static constexpr int kBlockSize = 1 << 16;
+
+    explicit ArrayGenerator(std::uint64_t seed = std::random_device{}(),
+                            int threads = (int)std::thread::hardware_concurrency())
+        : seed_(seed), threads_(std::max(1, threads)), gen(static_cast<std::mt19937::result_type>(seed)) {}
+
+    // Reproduces every array of this run when passed back to the constructor.
+    std::uint64_t seed() const {
+        return seed_;
+    }
+
+    // Fills data[0, size) with the given profile, e.g. straight into a mapped
+    // input file.
+    void generate(DataProfile profile, double* data, int size) {
+        switch (profile) {
+            case DataProfile::Random: generateRandomArray(data, size); break;
+            case DataProfile::Reversed: generateReversedSortedArray(data, size); break;
+            case DataProfile::AlmostSorted: generateAlmostSortedArray(data, size); break;
+            case DataProfile::Sorted: generateSortedArray(data, size); break;
+            case DataProfile::FewUnique: generateFewUniqueArray(data, size); break;
+            case DataProfile::AllEqual: generateAllEqualArray(data, size); break;
+            case DataProfile::OrganPipe: generateOrganPipeArray(data, size); break;
+            case DataProfile::Sawtooth: generateSawtoothArray(data, size); break;
+            case DataProfile::Zipfian: generateZipfianArray(data, size); break;
+            case DataProfile::SpecialValues: generateSpecialValuesArray(data, size); break;
+            case DataProfile::MedianOf3Killer: generateMedianOf3KillerArray(data, size); break;
+        }
+    }
+
+    std::vector<double> generate(DataProfile profile, int size) {
+        std::vector<double> arr(size);
+        generate(profile, arr.data(), size);
+        return arr;
+    }
+
+    void generateRandomArray(double* data, int size) {
+        parallelFill(DataProfile::Random, data, size,
+                     [](double* out, int begin, int end, std::mt19937_64& engine) {
+            std::uniform_real_distribution<> dist(0, 6000);
+            for (int i = begin; i < end; i++) {
+                out[i] = dist(engine);
+            }
+        });
+    }
+
+    void generateReversedSortedArray(double* data, int size) {
+        double step = 6000.0 / size;
+        parallelFill(DataProfile::Reversed, data, size,
+                     [step](double* out, int begin, int end, std::mt19937_64&) {
+            for (int i = begin; i < end; i++) {
+                out[i] = 6000 - i * step;
+            }
+        });
+    }
+
+    void generateSortedArray(double* data, int size) {
+        parallelFill(DataProfile::Sorted, data, size, [](double* out, int begin, int end, std::mt19937_64&) {
+            for (int i = begin; i < end; i++) {
+                out[i] = i;
+            }
+        });
+    }
+
+    void generateAlmostSortedArray(double* data, int size) {
+        generateSortedArray(data, size);
+        int swapNum = std::max(1, int(size * 0.01));
+        std::uniform_int_distribution<int> dist(0, size - 1);
+        for (int i = 0; i < swapNum; i++) {
+            int j = dist(gen);
+            int k = dist(gen);
+            std::swap(data[j], data[k]);
+        }
+    }
+
+    // Heavy duplicates: only distinctValues different keys.
+    void generateFewUniqueArray(double* data, int size, int distinctValues = 16) {
+        parallelFill(DataProfile::FewUnique, data, size,
+                     [distinctValues](double* out, int begin, int end, std::mt19937_64& engine) {
+            std::uniform_int_distribution<int> dist(0, distinctValues - 1);
+            for (int i = begin; i < end; i++) {
+                out[i] = dist(engine);
+            }
+        });
+    }
+
+    // Lomuto partitioning with `<= pivot` sends every element to one side
+    // here, so this is the quadratic input for partitionRandom no matter how
+    // the pivot is chosen.
+    void generateAllEqualArray(double* data, int size) {
+        std::fill(data, data + size, 42.0);
+    }
+
+    // Ascending to the middle, then descending.
+    void generateOrganPipeArray(double* data, int size) {
+        int half = size / 2;
+        parallelFill(DataProfile::OrganPipe, data, size,
+                     [half, size](double* out, int begin, int end, std::mt19937_64&) {
+            for (int i = begin; i < end; i++) {
+                out[i] = i < half ? i : size - 1 - i;
+            }
+        });
+    }
+
+    void generateSawtoothArray(double* data, int size, int period = 1000) {
+        parallelFill(DataProfile::Sawtooth, data, size,
+                     [period](double* out, int begin, int end, std::mt19937_64&) {
+            for (int i = begin; i < end; i++) {
+                out[i] = i % period;
+            }
+        });
+    }
+
+    // Keys 1..universe with P(k) proportional to 1 / k^skew.
+    void generateZipfianArray(double* data, int size, int universe = 1 << 20, double skew = 1.0) {
+        std::vector<double> cdf(universe);
+        double total = 0.0;
+        for (int k = 0; k < universe; k++) {
+            total += 1.0 / std::pow(k + 1.0, skew);
+            cdf[k] = total;
+        }
+        parallelFill(DataProfile::Zipfian, data, size,
+                     [&cdf, total](double* out, int begin, int end, std::mt19937_64& engine) {
+            std::uniform_real_distribution<> dist(0, total);
+            for (int i = begin; i < end; i++) {
+                auto it = std::upper_bound(cdf.begin(), cdf.end(), dist(engine));
+                out[i] = static_cast<double>(std::min<std::ptrdiff_t>(it - cdf.begin(), cdf.size() - 1) + 1);
+            }
+        });
+    }
+
+    // Random values with NaN, -0.0, +0.0 and infinities mixed in (1% each).
+    // NaN is unordered, so the order around it is unspecified, but a sort must
+    // still return a permutation of its input; the benchmarks check that with
+    // verifySort before timing.
+    void generateSpecialValuesArray(double* data, int size) {
+        parallelFill(DataProfile::SpecialValues, data, size,
+                     [](double* out, int begin, int end, std::mt19937_64& engine) {
+            const double special[] = {
+                std::numeric_limits<double>::quiet_NaN(), -0.0, 0.0,
+                std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()
+            };
+            std::uniform_real_distribution<> dist(0, 6000);
+            std::uniform_int_distribution<int> pick(0, 99);
+            for (int i = begin; i < end; i++) {
+                int p = pick(engine);
+                out[i] = p < 5 ? special[p] : dist(engine);
+            }
+        });
+    }
+
+    // Musser's median-of-3 killer: drives a median-of-three quicksort into
+    // quadratic time. partitionRandom draws its pivot at random and is not
+    // hurt by it, but the sequence stays in the suite for pivot-rule changes.
+    void generateMedianOf3KillerArray(double* data, int size) {
+        // The construction needs n divisible by 4; the tail is appended sorted.
+        int n = size - size % 4;
+        int k = n / 2;
+        for (int i = 1; i <= k; i++) {
+            if (i % 2 == 1) {
+                data[i - 1] = i;
+                data[i] = k + i;
+            }
+            data[k + i - 1] = 2 * i;
+        }
+        for (int i = n; i < size; i++) {
+            data[i] = i + 1;
+        }
+    }
+
+    // Replays real data: reads raw native-endian doubles from a binary file
+    // and copies a contiguous window of `size` values starting at a random
+    // offset into data, wrapping around when the file is shorter than
+    // requested.
+    void replayFromFile(const std::string& path, double* data, int size) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            throw std::runtime_error("cannot open " + path);
+        }
+        std::size_t count = static_cast<std::size_t>(file.tellg()) / sizeof(double);
+        if (count == 0) {
+            throw std::runtime_error(path + " contains no samples");
+        }
+        std::vector<double> samples(count);
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(samples.data()), count * sizeof(double));
+
+        std::uniform_int_distribution<std::size_t> dist(0, count - 1);
+        std::size_t offset = dist(gen);
+        for (int i = 0; i < size; i++) {
+            data[i] = samples[(offset + i) % count];
+        }
+    }
+
+private:
+    std::uint64_t seed_;
+    int threads_;
+    std::mt19937 gen;
+
+    static std::uint64_t splitmix64(std::uint64_t x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    // Each block's engine is seeded from the generator seed, the profile and
+    // the block index, so different profiles draw independent streams.
+    template <typename Fill>
+    void parallelFill(DataProfile profile, double* data, int size, Fill fill) {
+        int blocks = (size + kBlockSize - 1) / kBlockSize;
+        std::atomic<int> nextBlock{0};
+        auto worker = [&]() {
+            for (int b = nextBlock++; b < blocks; b = nextBlock++) {
+                const std::uint64_t stream =
+                    (static_cast<std::uint64_t>(profile) << 32) | static_cast<std::uint32_t>(b);
+                std::mt19937_64 engine(splitmix64(seed_ ^ splitmix64(stream)));
+                int begin = b * kBlockSize;
+                int end = std::min(size, begin + kBlockSize);
+                fill(data, begin, end, engine);
+            }
+        };
+
+        int threadCount = std::min(threads_, blocks);
+        if (threadCount <= 1) {
+            worker();
+            return;
+        }
+        std::vector<std::thread> pool;
+        for (int t = 1; t < threadCount; t++) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : pool) {
+            thread.join();
+        }
+    }
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ArrayGenerator.h"
+#include "MappedFile.h"
+
+// All benchmark inputs in one memory-mapped file: a small header with the
+// profile names, then one maxSize-long array of doubles per profile. The
+// arrays are generated once; every timed run copies the needed prefix from
+// this pristine snapshot with a single memcpy.
+class BenchmarkInputs {
+public:
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::size_t kNameLength = 32;
+
+    static BenchmarkInputs create(const std::string& path, int maxSize,
+                                  const std::vector<std::string>& profileNames) {
+        std::size_t offset = dataOffset(profileNames.size());
+        std::size_t bytes = offset + profileNames.size() * maxSize * sizeof(double);
+        BenchmarkInputs inputs(MappedFile::create(path, bytes));
+
+        char* base = inputs.file_.data();
+        Header header{{'S', 'B', 'I', 'N'}, kVersion,
+                      static_cast<std::uint32_t>(profileNames.size()),
+                      static_cast<std::uint32_t>(maxSize)};
+        std::memcpy(base, &header, sizeof(header));
+        for (size_t i = 0; i < profileNames.size(); ++i) {
+            if (profileNames[i].size() >= kNameLength) {
+                throw std::invalid_argument("profile name too long: " + profileNames[i]);
+            }
+            std::memcpy(base + sizeof(Header) + i * kNameLength, profileNames[i].c_str(),
+                        profileNames[i].size() + 1);
+        }
+        inputs.load();
+        return inputs;
+    }
+
+    int profileCount() const {
+        return (int)names_.size();
+    }
+
+    int maxSize() const {
+        return maxSize_;
+    }
+
+    const std::string& profileName(int i) const {
+        return names_[i];
+    }
+
+    const double* profile(int i) const {
+        return reinterpret_cast<const double*>(file_.data() + offset_) + (std::size_t)i * maxSize_;
+    }
+
+    double* mutableProfile(int i) {
+        return reinterpret_cast<double*>(file_.data() + offset_) + (std::size_t)i * maxSize_;
+    }
+
+private:
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t profileCount;
+        std::uint32_t maxSize;
+    };
+
+    MappedFile file_;
+    std::vector<std::string> names_;
+    int maxSize_ = 0;
+    std::size_t offset_ = 0;
+
+    explicit BenchmarkInputs(MappedFile file) : file_(std::move(file)) {}
+
+    // Arrays start on a cache-line boundary after the name table.
+    static std::size_t dataOffset(std::size_t profileCount) {
+        std::size_t end = sizeof(Header) + profileCount * kNameLength;
+        return (end + 63) / 64 * 64;
+    }
+
+    void load() {
+        Header header;
+        if (file_.size() < sizeof(header)) {
+            throw std::runtime_error("benchmark input file is truncated");
+        }
+        std::memcpy(&header, file_.data(), sizeof(header));
+        if (std::memcmp(header.magic, "SBIN", 4) != 0 || header.version != kVersion) {
+            throw std::runtime_error("not a benchmark input file of version 1");
+        }
+        offset_ = dataOffset(header.profileCount);
+        maxSize_ = (int)header.maxSize;
+        if (file_.size() < offset_ + (std::size_t)header.profileCount * maxSize_ * sizeof(double)) {
+            throw std::runtime_error("benchmark input file is truncated");
+        }
+        names_.clear();
+        for (std::uint32_t i = 0; i < header.profileCount; ++i) {
+            const char* name = file_.data() + sizeof(Header) + i * kNameLength;
+            names_.emplace_back(name, strnlen(name, kNameLength));
+        }
+    }
+};
+
+// Generates every data profile (plus an optional replayed file as "Replay")
+// at maxSize straight into a fresh input file. Smaller sizes sort a prefix,
+// so the shape-dependent profiles (OrganPipe, MedianOf3Killer) are exact only
+// at maxSize.
+inline BenchmarkInputs prepareBenchmarkInputs(const std::string& path, int maxSize,
+                                              ArrayGenerator& generator,
+                                              const std::string& replayPath = "") {
+    std::vector<std::string> names;
+    for (DataProfile profile : allDataProfiles()) {
+        names.push_back(dataProfileName(profile));
+    }
+    if (!replayPath.empty()) {
+        names.push_back("Replay");
+    }
+
+    BenchmarkInputs inputs = BenchmarkInputs::create(path, maxSize, names);
+    int index = 0;
+    for (DataProfile profile : allDataProfiles()) {
+        generator.generate(profile, inputs.mutableProfile(index++), maxSize);
+    }
+    if (!replayPath.empty()) {
+        generator.replayFromFile(replayPath, inputs.mutableProfile(index), maxSize);
+    }
+    return inputs;
+}
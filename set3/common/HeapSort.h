@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// Heap variants used as the introsort fallback and as a standalone priority
+// queue. The sorts take a pointer and an element count, (T* a, int n); the
+// vector-based sorts call them on a subarray as (a.data() + left, right - left + 1).
+
+enum class HeapFallback {
+    Binary,
+    BottomUp,
+    FourAry,
+    EightAry
+};
+
+// Bottom-up (Wegener) sift: walk down to a leaf taking the larger child with
+// one comparison per level, then climb back to where x belongs. Extraction
+// moves an element from the bottom to the root, so it almost always sinks back
+// to the leaf level and the climb is short.
+template <typename T>
+void siftDownBottomUp(T* a, int n, int i) {
+    const T x = a[i];
+    int j = i;
+    while (2 * j + 2 < n) {
+        int child = 2 * j + 1;
+        if (a[child] < a[child + 1]) {
+            child++;
+        }
+        j = child;
+    }
+    if (2 * j + 1 < n) {
+        j = 2 * j + 1;
+    }
+    while (x > a[j]) {
+        j = (j - 1) / 2;
+    }
+    T carry = x;
+    while (j > i) {
+        std::swap(carry, a[j]);
+        j = (j - 1) / 2;
+    }
+    a[i] = carry;
+}
+
+template <typename T>
+void bottomUpHeapSort(T* a, int n) {
+    if (n <= 1) {
+        return;
+    }
+    for (int i = n / 2 - 1; i >= 0; --i) {
+        siftDownBottomUp(a, n, i);
+    }
+    for (int i = n - 1; i > 0; --i) {
+        std::swap(a[0], a[i]);
+        siftDownBottomUp(a, i, 0);
+    }
+}
+
+// D-ary sift with a moving hole. The D children of a node are adjacent, so a
+// level costs one or two cache lines instead of one per child: for D = 8
+// doubles children 8i+1..8i+8 fill 64 bytes but start one element past a
+// multiple of 8, so on a line-aligned array they straddle two lines.
+template <int D, typename T, typename Compare = std::less<T>>
+void siftDownDary(T* a, int n, int i, Compare less = Compare()) {
+    const T x = a[i];
+    while (true) {
+        int first = D * i + 1;
+        if (first >= n) {
+            break;
+        }
+        int last = std::min(first + D, n);
+        int best = first;
+        for (int c = first + 1; c < last; c++) {
+            if (less(a[best], a[c])) {
+                best = c;
+            }
+        }
+        if (!less(x, a[best])) {
+            break;
+        }
+        a[i] = a[best];
+        i = best;
+    }
+    a[i] = x;
+}
+
+template <int D, typename T, typename Compare = std::less<T>>
+void siftUpDary(T* a, int i, Compare less = Compare()) {
+    const T x = a[i];
+    while (i > 0) {
+        int parent = (i - 1) / D;
+        if (!less(a[parent], x)) {
+            break;
+        }
+        a[i] = a[parent];
+        i = parent;
+    }
+    a[i] = x;
+}
+
+template <int D, typename T>
+void daryHeapSort(T* a, int n) {
+    static_assert(D >= 2, "heap arity must be at least 2");
+    if (n <= 1) {
+        return;
+    }
+    for (int i = (n - 2) / D; i >= 0; --i) {
+        siftDownDary<D>(a, n, i);
+    }
+    for (int i = n - 1; i > 0; --i) {
+        std::swap(a[0], a[i]);
+        siftDownDary<D>(a, i, 0);
+    }
+}
+
+// Priority queue on top of the D-ary sift. With Compare = std::less the top is
+// the largest element, as with std::priority_queue.
+template <typename T, int D = 4, typename Compare = std::less<T>>
+class DaryHeap {
+public:
+    explicit DaryHeap(Compare less = Compare()) : less_(less) {}
+
+    void reserve(std::size_t capacity) {
+        data_.reserve(capacity);
+    }
+
+    bool empty() const {
+        return data_.empty();
+    }
+
+    std::size_t size() const {
+        return data_.size();
+    }
+
+    const T& top() const {
+        return data_.front();
+    }
+
+    void push(const T& value) {
+        data_.push_back(value);
+        siftUpDary<D>(data_.data(), static_cast<int>(data_.size()) - 1, less_);
+    }
+
+    void pop() {
+        data_.front() = data_.back();
+        data_.pop_back();
+        if (!data_.empty()) {
+            siftDownDary<D>(data_.data(), static_cast<int>(data_.size()), 0, less_);
+        }
+    }
+
+    // Replaces the top element; cheaper than pop() followed by push().
+    void replaceTop(const T& value) {
+        data_.front() = value;
+        siftDownDary<D>(data_.data(), static_cast<int>(data_.size()), 0, less_);
+    }
+
+private:
+    std::vector<T> data_;
+    Compare less_;
+};
+
+// The k largest values in descending order, in O(n log k) with a min-heap of
+// the current candidates.
+inline std::vector<double> topK(const std::vector<double>& values, int k) {
+    if (k <= 0) {
+        return {};
+    }
+    DaryHeap<double, 4, std::greater<double>> heap;
+    heap.reserve(static_cast<std::size_t>(k));
+    for (double value : values) {
+        if ((int)heap.size() < k) {
+            heap.push(value);
+        } else if (value > heap.top()) {
+            heap.replaceTop(value);
+        }
+    }
+    std::vector<double> result(heap.size());
+    for (int i = (int)result.size() - 1; i >= 0; --i) {
+        result[i] = heap.top();
+        heap.pop();
+    }
+    return result;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Move-only RAII wrapper around a POSIX file mapping.
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    // Creates (or truncates) path with the given size and maps it read-write.
+    static MappedFile create(const std::string& path, std::size_t size) {
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("cannot create " + path);
+        }
+        if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            ::close(fd);
+            throw std::runtime_error("cannot resize " + path);
+        }
+        return MappedFile(fd, size, PROT_READ | PROT_WRITE, path);
+    }
+
+    MappedFile(MappedFile&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        unmap();
+    }
+
+    char* data() {
+        return static_cast<char*>(data_);
+    }
+
+    const char* data() const {
+        return static_cast<const char*>(data_);
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+private:
+    void* data_ = nullptr;
+    std::size_t size_ = 0;
+
+    MappedFile(int fd, std::size_t size, int protection, const std::string& path) : size_(size) {
+        if (size_ > 0) {
+            void* mapped = ::mmap(nullptr, size_, protection, MAP_SHARED, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("cannot map " + path);
+            }
+            data_ = mapped;
+        }
+        ::close(fd);
+    }
+
+    void unmap() {
+        if (data_ != nullptr) {
+            ::munmap(data_, size_);
+            data_ = nullptr;
+            size_ = 0;
+        }
+    }
+};
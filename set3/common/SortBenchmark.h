@@ -0,0 +1,551 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Shared timing harness for the sorting experiments. Every measurement runs
+// a few untimed warm-up sorts, then repeats until the spread of the samples
+// settles (or a cap is reached) and reports median/p95 instead of a mean of
+// five runs. Inputs come from a pristine snapshot (see BenchmarkInputs.h) and
+// are copied with one memcpy into a reused work buffer outside of the timed
+// region; results are streamed to disk as they are produced.
+
+inline std::atomic<std::uint64_t> g_sortBenchAllocations{0};
+
+// Define SORT_BENCH_COUNT_ALLOCATIONS in exactly one translation unit (the
+// benchmark's main file) to count heap allocations made by the sorts.
+#ifdef SORT_BENCH_COUNT_ALLOCATIONS
+// GCC pairs the replaced operators with the builtin ones and reports a
+// mismatched free() at every inlined std::allocator call site.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(std::size_t size) {
+    g_sortBenchAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+inline bool pinCurrentThread(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+// Cycles, branch misses and cache misses of the calling thread through
+// perf_event_open. Silently unavailable when the kernel or the sandbox does
+// not allow it; the results then carry -1 in these columns.
+class PerfCounters {
+public:
+    static constexpr int kCounterCount = 3;
+
+    PerfCounters() {
+#ifdef __linux__
+        const std::uint64_t configs[kCounterCount] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_BRANCH_MISSES,
+            PERF_COUNT_HW_CACHE_MISSES
+        };
+        for (int i = 0; i < kCounterCount; i++) {
+            perf_event_attr attr{};
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = configs[i];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fds_[i] < 0) {
+                closeAll();
+                return;
+            }
+        }
+        available_ = true;
+#endif
+    }
+
+    ~PerfCounters() {
+        closeAll();
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const {
+        return available_;
+    }
+
+    void start() {
+#ifdef __linux__
+        if (!available_) {
+            return;
+        }
+        for (int fd : fds_) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    // Stops counting and stores cycles, branch misses and cache misses in out.
+    void stop(double out[kCounterCount]) {
+        for (int i = 0; i < kCounterCount; i++) {
+            out[i] = -1.0;
+        }
+#ifdef __linux__
+        if (!available_) {
+            return;
+        }
+        for (int i = 0; i < kCounterCount; i++) {
+            ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+            std::uint64_t value = 0;
+            if (read(fds_[i], &value, sizeof(value)) == sizeof(value)) {
+                out[i] = static_cast<double>(value);
+            }
+        }
+#endif
+    }
+
+private:
+    int fds_[kCounterCount] = {-1, -1, -1};
+    bool available_ = false;
+
+    void closeAll() {
+#ifdef __linux__
+        for (int& fd : fds_) {
+            if (fd >= 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+#endif
+        available_ = false;
+    }
+};
+
+struct BenchmarkConfig {
+    int warmupRuns = 2;
+    int minRepeats = 5;
+    int maxRepeats = 101;
+    // Stop early once the samples are this tight (MAD / median) ...
+    double targetRelativeSpread = 0.02;
+    // ... or once this much time has been spent on the measurement.
+    double maxTotalMicroseconds = 2e6;
+    int pinnedCpu = 0;
+};
+
+struct BenchmarkResult {
+    std::string_view algorithm;
+    std::string_view dataType;
+    int size = 0;
+    int repeats = 0;
+    double medianMicroseconds = 0.0;
+    double p95Microseconds = 0.0;
+    double meanMicroseconds = 0.0;
+    double minMicroseconds = 0.0;
+    double cycles = -1.0;
+    double branchMisses = -1.0;
+    double cacheMisses = -1.0;
+    double allocationsPerRun = 0.0;
+};
+
+// Sorts values in place and interpolates the q-th quantile.
+inline double percentile(std::vector<double>& values, double q) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    double rank = q * (values.size() - 1);
+    std::size_t lo = static_cast<std::size_t>(rank);
+    std::size_t hi = std::min(lo + 1, values.size() - 1);
+    double frac = rank - lo;
+    return values[lo] + (values[hi] - values[lo]) * frac;
+}
+
+class SortBenchmark {
+public:
+    explicit SortBenchmark(BenchmarkConfig config = BenchmarkConfig()) : config_(config) {
+        if (config_.pinnedCpu >= 0) {
+            pinCurrentThread(config_.pinnedCpu);
+        }
+        times_.reserve(config_.maxRepeats);
+        cycles_.reserve(config_.maxRepeats);
+        branchMisses_.reserve(config_.maxRepeats);
+        cacheMisses_.reserve(config_.maxRepeats);
+        scratch_.reserve(config_.maxRepeats);
+    }
+
+    bool hardwareCountersAvailable() const {
+        return counters_.available();
+    }
+
+    // The names must outlive the returned result (string literals or the
+    // profile names of a BenchmarkInputs).
+    template <typename SortFn>
+    BenchmarkResult run(std::string_view algorithm, std::string_view dataType,
+                        const double* input, int size, SortFn sort) {
+        work_.resize(size);
+        const std::size_t bytes = static_cast<std::size_t>(size) * sizeof(double);
+
+        for (int i = 0; i < config_.warmupRuns; i++) {
+            std::memcpy(work_.data(), input, bytes);
+            sort(work_);
+        }
+
+        times_.clear();
+        cycles_.clear();
+        branchMisses_.clear();
+        cacheMisses_.clear();
+        std::uint64_t allocations = 0;
+        double totalTime = 0.0;
+        double minTime = 0.0;
+
+        while ((int)times_.size() < config_.maxRepeats) {
+            std::memcpy(work_.data(), input, bytes);
+
+            std::uint64_t allocationsBefore = g_sortBenchAllocations.load(std::memory_order_relaxed);
+            double counts[PerfCounters::kCounterCount];
+            counters_.start();
+            auto start = std::chrono::steady_clock::now();
+            sort(work_);
+            auto end = std::chrono::steady_clock::now();
+            counters_.stop(counts);
+            allocations += g_sortBenchAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+
+            double elapsed = std::chrono::duration<double, std::micro>(end - start).count();
+            minTime = times_.empty() ? elapsed : std::min(minTime, elapsed);
+            times_.push_back(elapsed);
+            cycles_.push_back(counts[0]);
+            branchMisses_.push_back(counts[1]);
+            cacheMisses_.push_back(counts[2]);
+            totalTime += elapsed;
+
+            if ((int)times_.size() >= config_.minRepeats &&
+                (totalTime >= config_.maxTotalMicroseconds || isStable())) {
+                break;
+            }
+        }
+
+        BenchmarkResult result;
+        result.algorithm = algorithm;
+        result.dataType = dataType;
+        result.size = size;
+        result.repeats = (int)times_.size();
+        result.meanMicroseconds = totalTime / times_.size();
+        result.minMicroseconds = minTime;
+        result.allocationsPerRun = static_cast<double>(allocations) / times_.size();
+        result.medianMicroseconds = percentile(times_, 0.5);
+        result.p95Microseconds = percentile(times_, 0.95);
+        result.cycles = percentile(cycles_, 0.5);
+        result.branchMisses = percentile(branchMisses_, 0.5);
+        result.cacheMisses = percentile(cacheMisses_, 0.5);
+        return result;
+    }
+
+    // Sorts a copy of input[0..size) once, untimed, and throws
+    // std::logic_error unless the output is a bitwise permutation of the
+    // input (so NaN and the sign of zero are counted) that is also sorted
+    // when the input has no NaN.
+    template <typename SortFn>
+    void verifySort(std::string_view algorithm, std::string_view dataType,
+                    const double* input, int size, SortFn sort) {
+        work_.assign(input, input + size);
+        sort(work_);
+
+        std::vector<std::uint64_t> before(size);
+        std::vector<std::uint64_t> after(size);
+        std::memcpy(before.data(), input, static_cast<std::size_t>(size) * sizeof(double));
+        std::memcpy(after.data(), work_.data(), static_cast<std::size_t>(size) * sizeof(double));
+        std::sort(before.begin(), before.end());
+        std::sort(after.begin(), after.end());
+        std::string what = std::string(algorithm) + " on " + std::string(dataType);
+        if ((int)work_.size() != size || before != after) {
+            throw std::logic_error(what + " does not return a permutation of its input");
+        }
+        bool hasNaN = std::any_of(input, input + size, [](double x) { return x != x; });
+        if (!hasNaN && !std::is_sorted(work_.begin(), work_.end())) {
+            throw std::logic_error(what + " does not sort its input");
+        }
+    }
+
+private:
+    BenchmarkConfig config_;
+    PerfCounters counters_;
+    std::vector<double> work_;
+    std::vector<double> times_;
+    std::vector<double> cycles_;
+    std::vector<double> branchMisses_;
+    std::vector<double> cacheMisses_;
+    std::vector<double> scratch_;
+
+    bool isStable() {
+        scratch_.assign(times_.begin(), times_.end());
+        double median = percentile(scratch_, 0.5);
+        if (median <= 0.0) {
+            return true;
+        }
+        for (double& t : scratch_) {
+            t = t > median ? t - median : median - t;
+        }
+        return percentile(scratch_, 0.5) / median <= config_.targetRelativeSpread;
+    }
+};
+
+enum class ResultFormat {
+    Binary,
+    CSV,
+    JSON
+};
+
+// Fixed-size binary record; algorithm and data type are ids into a string
+// dictionary that is written inline the first time a name is seen.
+struct BinaryResultRecord {
+    std::uint16_t algorithmId;
+    std::uint16_t dataTypeId;
+    std::uint32_t size;
+    std::uint32_t repeats;
+    std::uint32_t reserved;
+    double medianMicroseconds;
+    double p95Microseconds;
+    double meanMicroseconds;
+    double minMicroseconds;
+    double cycles;
+    double branchMisses;
+    double cacheMisses;
+    double allocationsPerRun;
+};
+
+// Streams results to disk as they are produced, in one schema for every sort
+// variant, data profile and size. Binary is the default: a "SRES" header with
+// the input seed, then tagged entries ('S' = dictionary string,
+// 'R' = BinaryResultRecord). convertResultsToCSV turns such a file into CSV
+// afterwards. The text formats repeat the seed in every row.
+class ResultStream {
+public:
+    static constexpr std::uint32_t kVersion = 2;
+
+    ResultStream(const std::string& filename, ResultFormat format, std::uint64_t seed)
+        : format_(format), seed_(seed), buffer_(1 << 16) {
+        file_ = std::fopen(filename.c_str(), format_ == ResultFormat::Binary ? "wb" : "w");
+        if (file_ == nullptr) {
+            throw std::runtime_error("cannot open " + filename);
+        }
+        std::setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+        if (format_ == ResultFormat::Binary) {
+            std::fwrite("SRES", 1, 4, file_);
+            std::fwrite(&kVersion, sizeof(kVersion), 1, file_);
+            std::fwrite(&seed_, sizeof(seed_), 1, file_);
+        } else if (format_ == ResultFormat::CSV) {
+            std::fputs(kCsvHeader, file_);
+        } else {
+            std::fputs("[\n", file_);
+        }
+    }
+
+    ~ResultStream() {
+        if (format_ == ResultFormat::JSON) {
+            std::fputs(count_ > 0 ? "\n]\n" : "]\n", file_);
+        }
+        std::fclose(file_);
+    }
+
+    ResultStream(const ResultStream&) = delete;
+    ResultStream& operator=(const ResultStream&) = delete;
+
+    std::size_t count() const {
+        return count_;
+    }
+
+    void write(const BenchmarkResult& r) {
+        switch (format_) {
+            case ResultFormat::Binary: {
+                BinaryResultRecord record{intern(r.algorithm), intern(r.dataType),
+                                          static_cast<std::uint32_t>(r.size),
+                                          static_cast<std::uint32_t>(r.repeats), 0,
+                                          r.medianMicroseconds, r.p95Microseconds,
+                                          r.meanMicroseconds, r.minMicroseconds,
+                                          r.cycles, r.branchMisses, r.cacheMisses,
+                                          r.allocationsPerRun};
+                std::fputc('R', file_);
+                std::fwrite(&record, sizeof(record), 1, file_);
+                break;
+            }
+            case ResultFormat::CSV:
+                writeCsvRow(file_, r, seed_);
+                break;
+            case ResultFormat::JSON:
+                std::fprintf(file_,
+                    "%s  {\"algorithm\": \"%.*s\", \"dataType\": \"%.*s\", \"size\": %d, "
+                    "\"repeats\": %d, \"medianUs\": %.3f, \"p95Us\": %.3f, \"meanUs\": %.3f, "
+                    "\"minUs\": %.3f, \"cycles\": %.0f, \"branchMisses\": %.0f, "
+                    "\"cacheMisses\": %.0f, \"allocationsPerRun\": %.3f, \"seed\": %llu}",
+                    count_ > 0 ? ",\n" : "",
+                    (int)r.algorithm.size(), r.algorithm.data(),
+                    (int)r.dataType.size(), r.dataType.data(), r.size, r.repeats,
+                    r.medianMicroseconds, r.p95Microseconds, r.meanMicroseconds,
+                    r.minMicroseconds, r.cycles, r.branchMisses, r.cacheMisses,
+                    r.allocationsPerRun, static_cast<unsigned long long>(seed_));
+                break;
+        }
+        count_++;
+    }
+
+    static constexpr const char* kCsvHeader =
+        "Algorithm,DataType,Size,Repeats,MedianUs,P95Us,MeanUs,MinUs,"
+        "Cycles,BranchMisses,CacheMisses,AllocationsPerRun,Seed\n";
+
+    static void writeCsvRow(std::FILE* file, const BenchmarkResult& r, std::uint64_t seed) {
+        std::fprintf(file, "%.*s,%.*s,%d,%d,%.3f,%.3f,%.3f,%.3f,%.0f,%.0f,%.0f,%.3f,%llu\n",
+                     (int)r.algorithm.size(), r.algorithm.data(),
+                     (int)r.dataType.size(), r.dataType.data(), r.size, r.repeats,
+                     r.medianMicroseconds, r.p95Microseconds, r.meanMicroseconds,
+                     r.minMicroseconds, r.cycles, r.branchMisses, r.cacheMisses,
+                     r.allocationsPerRun, static_cast<unsigned long long>(seed));
+    }
+
+private:
+    std::FILE* file_ = nullptr;
+    ResultFormat format_;
+    std::uint64_t seed_;
+    std::vector<char> buffer_;
+    std::vector<std::string> dictionary_;
+    std::size_t count_ = 0;
+
+    std::uint16_t intern(std::string_view name) {
+        for (size_t i = 0; i < dictionary_.size(); ++i) {
+            if (dictionary_[i] == name) {
+                return static_cast<std::uint16_t>(i);
+            }
+        }
+        std::uint16_t id = static_cast<std::uint16_t>(dictionary_.size());
+        std::uint16_t length = static_cast<std::uint16_t>(name.size());
+        dictionary_.emplace_back(name);
+        std::fputc('S', file_);
+        std::fwrite(&id, sizeof(id), 1, file_);
+        std::fwrite(&length, sizeof(length), 1, file_);
+        std::fwrite(name.data(), 1, name.size(), file_);
+        return id;
+    }
+};
+
+// Writes the records of a binary result stream as CSV with the kCsvHeader
+// columns. Throws std::runtime_error on a truncated or corrupt stream.
+inline void convertResultsToCSV(const std::string& binaryFile, const std::string& csvFile) {
+    std::FILE* in = std::fopen(binaryFile.c_str(), "rb");
+    if (in == nullptr) {
+        throw std::runtime_error("cannot open " + binaryFile);
+    }
+    char magic[4];
+    std::uint32_t version = 0;
+    std::uint64_t seed = 0;
+    if (std::fread(magic, 1, 4, in) != 4 || std::memcmp(magic, "SRES", 4) != 0 ||
+        std::fread(&version, sizeof(version), 1, in) != 1 || version != ResultStream::kVersion ||
+        std::fread(&seed, sizeof(seed), 1, in) != 1) {
+        std::fclose(in);
+        throw std::runtime_error(binaryFile + " is not a result stream of version 2");
+    }
+    std::FILE* out = std::fopen(csvFile.c_str(), "w");
+    if (out == nullptr) {
+        std::fclose(in);
+        throw std::runtime_error("cannot open " + csvFile);
+    }
+    std::fputs(ResultStream::kCsvHeader, out);
+
+    // Every read is checked: a truncated or corrupt stream is an error rather
+    // than a CSV with garbage names or silently missing rows.
+    auto fail = [&](const char* what) {
+        std::fclose(out);
+        std::fclose(in);
+        throw std::runtime_error(binaryFile + " " + what);
+    };
+    auto readExact = [&](void* data, std::size_t bytes) {
+        if (bytes > 0 && std::fread(data, 1, bytes, in) != bytes) {
+            fail("is truncated");
+        }
+    };
+
+    std::vector<std::string> dictionary;
+    auto lookup = [&](std::uint16_t id) -> const std::string& {
+        if (id >= dictionary.size()) {
+            fail("refers to an undefined name");
+        }
+        return dictionary[id];
+    };
+    int tag;
+    while ((tag = std::fgetc(in)) != EOF) {
+        if (tag == 'S') {
+            std::uint16_t id = 0;
+            std::uint16_t length = 0;
+            readExact(&id, sizeof(id));
+            readExact(&length, sizeof(length));
+            std::string name(length, '\0');
+            readExact(name.data(), length);
+            dictionary.resize(std::max<std::size_t>(dictionary.size(), id + 1));
+            dictionary[id] = name;
+        } else if (tag == 'R') {
+            BinaryResultRecord record;
+            readExact(&record, sizeof(record));
+            BenchmarkResult r;
+            r.algorithm = lookup(record.algorithmId);
+            r.dataType = lookup(record.dataTypeId);
+            r.size = (int)record.size;
+            r.repeats = (int)record.repeats;
+            r.medianMicroseconds = record.medianMicroseconds;
+            r.p95Microseconds = record.p95Microseconds;
+            r.meanMicroseconds = record.meanMicroseconds;
+            r.minMicroseconds = record.minMicroseconds;
+            r.cycles = record.cycles;
+            r.branchMisses = record.branchMisses;
+            r.cacheMisses = record.cacheMisses;
+            r.allocationsPerRun = record.allocationsPerRun;
+            ResultStream::writeCsvRow(out, r, seed);
+        } else {
+            fail("contains an unknown entry");
+        }
+    }
+    if (std::ferror(in)) {
+        fail("could not be read");
+    }
+    std::fclose(out);
+    std::fclose(in);
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Batcher's odd-even merge networks generated at compile time for every size
+// up to kMaxNetworkSize. Each comparator is a branchless conditional swap, so
+// a small subarray is sorted without data-dependent branches (a compare and
+// two selects, and the compiler is free to pack independent comparators of a
+// layer). Unlike a min/max pair, a swap only moves values: an unordered pair
+// (NaN) or an equal but distinct pair (-0.0, +0.0) is left as it is instead of
+// one value being duplicated over the other.
+
+constexpr int kMaxNetworkSize = 32;
+constexpr int kMaxComparators = 256;
+
+struct Comparator {
+    int i = 0;
+    int j = 0;
+};
+
+struct NetworkTable {
+    std::array<Comparator, kMaxComparators> comparators{};
+    int count = 0;
+};
+
+constexpr NetworkTable buildOddEvenMergeNetwork(int n) {
+    NetworkTable table{};
+    for (int p = 1; p < n; p *= 2) {
+        for (int k = p; k >= 1; k /= 2) {
+            for (int j = k % p; j <= n - 1 - k; j += 2 * k) {
+                int last = std::min(k - 1, n - j - k - 1);
+                for (int i = 0; i <= last; i++) {
+                    if ((i + j) / (2 * p) == (i + j + k) / (2 * p)) {
+                        table.comparators[table.count].i = i + j;
+                        table.comparators[table.count].j = i + j + k;
+                        table.count++;
+                    }
+                }
+            }
+        }
+    }
+    return table;
+}
+
+template <typename T>
+inline void compareExchange(T* a, int i, int j) {
+    const T x = a[i];
+    const T y = a[j];
+    const bool outOfOrder = y < x;
+    a[i] = outOfOrder ? y : x;
+    a[j] = outOfOrder ? x : y;
+}
+
+template <int N>
+struct SortingNetwork {
+    static_assert(N >= 0 && N <= kMaxNetworkSize, "network size out of range");
+
+    static constexpr NetworkTable table = buildOddEvenMergeNetwork(N);
+
+    template <typename T, std::size_t... I>
+    static void apply([[maybe_unused]] T* a, std::index_sequence<I...>) {
+        (compareExchange(a, table.comparators[I].i, table.comparators[I].j), ...);
+    }
+
+    template <typename T>
+    static void sort(T* a) {
+        apply(a, std::make_index_sequence<static_cast<std::size_t>(table.count)>{});
+    }
+};
+
+template <typename T, std::size_t... N>
+constexpr std::array<void (*)(T*), sizeof...(N)> makeNetworkDispatch(std::index_sequence<N...>) {
+    return {&SortingNetwork<static_cast<int>(N)>::template sort<T>...};
+}
+
+// Sorts a[0..n) with the network for exactly n elements, n <= kMaxNetworkSize.
+template <typename T>
+inline void networkSort(T* a, int n) {
+    static constexpr auto dispatch =
+        makeNetworkDispatch<T>(std::make_index_sequence<kMaxNetworkSize + 1>{});
+    dispatch[n](a);
+}
+
+// Checks networkSort for every size against std::sort on random inputs drawn
+// from a few values with duplicates, -0.0, +0.0, infinities and NaN. The
+// output must always be a bitwise permutation of the input; without NaN it
+// must also equal the std::sort result. Throws std::logic_error otherwise.
+inline void checkSortingNetworks(int trialsPerSize = 200) {
+    const double values[] = {
+        1.0, 2.0, 3.0, -1.0, 0.0, -0.0,
+        std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(),
+        std::numeric_limits<double>::quiet_NaN()
+    };
+    const int valueCount = sizeof(values) / sizeof(values[0]);
+    auto bits = [](const std::vector<double>& a) {
+        std::vector<std::uint64_t> out(a.size());
+        std::memcpy(out.data(), a.data(), a.size() * sizeof(double));
+        std::sort(out.begin(), out.end());
+        return out;
+    };
+
+    std::mt19937 gen(2024);
+    for (int n = 0; n <= kMaxNetworkSize; n++) {
+        for (int trial = 0; trial < trialsPerSize; trial++) {
+            // Every other trial leaves NaN out so the result is comparable.
+            std::uniform_int_distribution<int> pick(0, trial % 2 == 0 ? valueCount - 2 : valueCount - 1);
+            std::vector<double> input(n);
+            bool hasNaN = false;
+            for (double& x : input) {
+                x = values[pick(gen)];
+                hasNaN = hasNaN || std::isnan(x);
+            }
+
+            std::vector<double> sorted = input;
+            networkSort(sorted.data(), n);
+            if (bits(sorted) != bits(input)) {
+                throw std::logic_error("networkSort(" + std::to_string(n) + ") lost or duplicated an element");
+            }
+            if (!hasNaN) {
+                std::vector<double> expected = input;
+                std::sort(expected.begin(), expected.end());
+                if (!std::equal(sorted.begin(), sorted.end(), expected.begin())) {
+                    throw std::logic_error("networkSort(" + std::to_string(n) + ") differs from std::sort");
+                }
+            }
+        }
+    }
+}
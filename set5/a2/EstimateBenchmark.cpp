@@ -0,0 +1,141 @@
+// Cost of updates and cardinality queries as the register count grows.
+//
+//   g++ -std=c++17 -O2 EstimateBenchmark.cpp -o estimate_benchmark
+//
+// For each precision the sketch is first filled past the sparse phase, then
+// three timings are printed in nanoseconds: Add alone, Add followed by
+// Estimate (a query after every update), and Estimate alone. For
+// comparison, "rescan" is the old approach of summing all registers on
+// every query. The rows marked "s" time the same operations on fresh
+// sketches that are fed 2^p / 8 keys each, so they never leave the sparse
+// representation.
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "HyperLogLog.h"
+#include "RandomStreamGen.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double NanosecondsPerOp(Clock::time_point begin, Clock::time_point end, std::size_t ops) {
+  return std::chrono::duration<double, std::nano>(end - begin).count() / static_cast<double>(ops);
+}
+
+double RescanEstimate(const PackedRegisters& registers) {
+  double harmonicSum = 0.0;
+  for (std::uint32_t i = 0; i < registers.Size(); ++i) {
+    harmonicSum += std::ldexp(1.0, -static_cast<int>(registers[i]));
+  }
+  return harmonicSum;
+}
+
+// Keeps results alive so the timed loops are not optimized away.
+volatile double g_sink = 0.0;
+
+template <int P>
+void Run(const std::vector<std::string>& warm, const std::vector<std::string>& timed, std::size_t queries) {
+  using Sketch = HyperLogLogUltraMax<WyHash64, P>;
+  Sketch sketch(1);
+  for (const std::string& value : warm) sketch.Add(value);
+
+  Sketch addOnly = sketch;
+  auto begin = Clock::now();
+  for (const std::string& value : timed) addOnly.Add(value);
+  const double addNs = NanosecondsPerOp(begin, Clock::now(), timed.size());
+  g_sink = addOnly.Estimate();
+
+  Sketch addQuery = sketch;
+  double sum = 0.0;
+  begin = Clock::now();
+  for (const std::string& value : timed) {
+    addQuery.Add(value);
+    sum += addQuery.Estimate();
+  }
+  const double addQueryNs = NanosecondsPerOp(begin, Clock::now(), timed.size());
+  g_sink = sum;
+
+  sum = 0.0;
+  begin = Clock::now();
+  for (std::size_t i = 0; i < queries; ++i) sum += sketch.Estimate();
+  const double estimateNs = NanosecondsPerOp(begin, Clock::now(), queries);
+  g_sink = sum;
+
+  const std::size_t rescans = queries / (std::size_t(1) << (P - 8));
+  sum = 0.0;
+  begin = Clock::now();
+  for (std::size_t i = 0; i < rescans; ++i) sum += RescanEstimate(sketch.Registers().Registers());
+  const double rescanNs = NanosecondsPerOp(begin, Clock::now(), rescans);
+  g_sink = sum;
+
+  std::printf("%-4d %12.1f %16.1f %14.1f %14.1f\n", P, addNs, addQueryNs, estimateNs, rescanNs);
+}
+
+template <int P>
+void RunSparse(const std::vector<std::string>& timed) {
+  using Sketch = HyperLogLogUltraMax<WyHash64, P>;
+  const std::size_t perSketch = std::size_t(1) << (P - 3);
+  const std::size_t sketches = timed.size() / perSketch;
+  const std::size_t ops = sketches * perSketch;
+
+  auto begin = Clock::now();
+  for (std::size_t s = 0; s < sketches; ++s) {
+    Sketch sketch(s);
+    for (std::size_t i = s * perSketch; i < (s + 1) * perSketch; ++i) sketch.Add(timed[i]);
+    g_sink = sketch.Estimate();
+  }
+  const double addNs = NanosecondsPerOp(begin, Clock::now(), ops);
+
+  double sum = 0.0;
+  begin = Clock::now();
+  for (std::size_t s = 0; s < sketches; ++s) {
+    Sketch sketch(s);
+    for (std::size_t i = s * perSketch; i < (s + 1) * perSketch; ++i) {
+      sketch.Add(timed[i]);
+      sum += sketch.Estimate();
+    }
+    if (!sketch.Registers().IsSparse()) std::printf("p=%d left the sparse phase\n", P);
+  }
+  const double addQueryNs = NanosecondsPerOp(begin, Clock::now(), ops);
+  g_sink = sum;
+
+  Sketch sketch(0);
+  for (std::size_t i = 0; i < perSketch; ++i) sketch.Add(timed[i]);
+  sum = 0.0;
+  begin = Clock::now();
+  for (std::size_t i = 0; i < ops; ++i) sum += sketch.Estimate();
+  const double estimateNs = NanosecondsPerOp(begin, Clock::now(), ops);
+  g_sink = sum;
+
+  std::printf("%-4s %12.1f %16.1f %14.1f %14s\n", (std::to_string(P) + "s").c_str(), addNs, addQueryNs,
+              estimateNs, "-");
+}
+
+}  // namespace
+
+int main() {
+  const std::size_t warmItems = 1000000;
+  const std::size_t timedItems = 1000000;
+  const std::size_t queries = 200000;
+
+  RandomStreamGen generator(7);
+  const std::vector<std::string> warm = generator.generate(warmItems);
+  const std::vector<std::string> timed = generator.generate(timedItems);
+
+  std::printf("%-4s %12s %16s %14s %14s\n", "p", "add", "add+estimate", "estimate", "rescan");
+  Run<10>(warm, timed, queries);
+  Run<12>(warm, timed, queries);
+  Run<14>(warm, timed, queries);
+  Run<16>(warm, timed, queries);
+  Run<18>(warm, timed, queries);
+  RunSparse<12>(timed);
+  RunSparse<14>(timed);
+  return 0;
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "HashFuncGen.h"
+
+// Ground truth for the accuracy experiments. Keys are reduced to 64-bit
+// fingerprints, so the count is exact up to fingerprint collisions: about
+// n^2 / 2^65 of them are expected, 0.03 at n = 10^9.
+
+// Open-addressing set of 64-bit values, laid out like a Swiss table: slots
+// come in groups of 16 with one control byte each, 0 for empty and
+// 0x80 | (top 7 bits of the value) for full. A lookup compares the 16
+// control bytes of a group at once (SSE2 when available) and only touches
+// the slots whose tag matches. There are no deletions, so no tombstones.
+class FingerprintSet {
+public:
+  static constexpr std::size_t kGroupSize = 16;
+
+  FingerprintSet() { Reset(16); }
+
+  // Returns true when the value was not in the set yet.
+  bool Insert(std::uint64_t value) {
+    if ((size_ + 1) * 8 > slots_.size() * 7) Reset(2 * GroupCount());
+    const std::uint8_t tag = Tag(value);
+    std::size_t group = static_cast<std::size_t>(value) & groupMask_;
+    while (true) {
+      const std::uint8_t* ctrl = ctrl_.data() + group * kGroupSize;
+      for (std::uint32_t match = Match(ctrl, tag); match != 0; match &= match - 1) {
+        if (slots_[group * kGroupSize + __builtin_ctz(match)] == value) return false;
+      }
+      const std::uint32_t empty = Match(ctrl, 0);
+      if (empty != 0) {
+        const std::size_t slot = group * kGroupSize + __builtin_ctz(empty);
+        ctrl_[slot] = tag;
+        slots_[slot] = value;
+        ++size_;
+        return true;
+      }
+      group = (group + 1) & groupMask_;
+    }
+  }
+
+  std::size_t Size() const { return size_; }
+
+  std::size_t MemoryUsage() const {
+    return ctrl_.capacity() + slots_.capacity() * sizeof(std::uint64_t);
+  }
+
+  // Empties the set but keeps its capacity.
+  void Clear() {
+    std::fill(ctrl_.begin(), ctrl_.end(), 0);
+    size_ = 0;
+  }
+
+private:
+  std::vector<std::uint8_t> ctrl_;
+  std::vector<std::uint64_t> slots_;
+  std::size_t groupMask_ = 0;
+  std::size_t size_ = 0;
+
+  std::size_t GroupCount() const { return groupMask_ + 1; }
+
+  static std::uint8_t Tag(std::uint64_t value) {
+    return static_cast<std::uint8_t>(0x80u | (value >> 57));
+  }
+
+  // Bit i is set when ctrl[i] == byte.
+  static std::uint32_t Match(const std::uint8_t* ctrl, std::uint8_t byte) {
+#if defined(__SSE2__)
+    const __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+    const __m128i target = _mm_set1_epi8(static_cast<char>(byte));
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, target)));
+#else
+    std::uint32_t mask = 0;
+    for (std::size_t i = 0; i < kGroupSize; ++i) {
+      mask |= static_cast<std::uint32_t>(ctrl[i] == byte) << i;
+    }
+    return mask;
+#endif
+  }
+
+  // Rebuilds the table with groupCount groups (a power of two), keeping the
+  // current values.
+  void Reset(std::size_t groupCount) {
+    std::vector<std::uint8_t> oldCtrl(groupCount * kGroupSize, 0);
+    std::vector<std::uint64_t> oldSlots(groupCount * kGroupSize);
+    oldCtrl.swap(ctrl_);
+    oldSlots.swap(slots_);
+    groupMask_ = groupCount - 1;
+    size_ = 0;
+    for (std::size_t i = 0; i < oldCtrl.size(); ++i) {
+      if (oldCtrl[i] != 0u) Insert(oldSlots[i]);
+    }
+  }
+};
+
+// Exact distinct count of a stream of keys, kept in memory and available
+// after every Add. Takes about 10-20 bytes per distinct key, against
+// ~60 bytes plus the key itself for std::unordered_set<std::string>.
+class ExactDistinctCounter {
+public:
+  static constexpr std::uint64_t kFingerprintSeed = 0x5bd1e9955bd1e995ULL;
+
+  ExactDistinctCounter() : hasher_(kFingerprintSeed) {}
+
+  // Returns true when key was seen for the first time.
+  bool Add(std::string_view key) { return set_.Insert(hasher_(key)); }
+
+  std::size_t Count() const { return set_.Size(); }
+  std::size_t MemoryUsage() const { return set_.MemoryUsage(); }
+
+private:
+  WyHash64 hasher_;
+  FingerprintSet set_;
+};
+
+// Exact distinct count for streams whose fingerprints do not fit in memory.
+// Add appends each fingerprint to one of 2^partitionBits files in directory,
+// chosen by fingerprint bits that FingerprintSet does not use for its group
+// index. Count() then deduplicates one partition at a time, so peak memory
+// is one partition's set. Equal keys always land in the same partition, so
+// the partition counts add up. The files are removed by the destructor.
+class PartitionedDistinctCounter {
+public:
+  static constexpr std::size_t kBufferedFingerprints = 4096;
+
+  explicit PartitionedDistinctCounter(std::string directory, int partitionBits = 6)
+      : directory_(std::move(directory)),
+        partitionBits_(partitionBits),
+        hasher_(ExactDistinctCounter::kFingerprintSeed),
+        buffers_(std::size_t(1) << partitionBits) {
+    for (std::size_t i = 0; i < buffers_.size(); ++i) {
+      files_.emplace_back(PartitionPath(i), std::ios::binary | std::ios::trunc);
+      if (!files_.back()) {
+        throw std::runtime_error("cannot create " + PartitionPath(i));
+      }
+      buffers_[i].reserve(kBufferedFingerprints);
+    }
+  }
+
+  PartitionedDistinctCounter(const PartitionedDistinctCounter&) = delete;
+  PartitionedDistinctCounter& operator=(const PartitionedDistinctCounter&) = delete;
+
+  ~PartitionedDistinctCounter() {
+    for (std::size_t i = 0; i < files_.size(); ++i) {
+      files_[i].close();
+      std::remove(PartitionPath(i).c_str());
+    }
+  }
+
+  void Add(std::string_view key) { AddFingerprint(hasher_(key)); }
+
+  void AddFingerprint(std::uint64_t fingerprint) {
+    const std::size_t partition = static_cast<std::size_t>(fingerprint >> 40) & (buffers_.size() - 1);
+    std::vector<std::uint64_t>& buffer = buffers_[partition];
+    buffer.push_back(fingerprint);
+    if (buffer.size() == kBufferedFingerprints) Spill(partition);
+  }
+
+  // Number of distinct keys added so far. Reads every partition back, so
+  // call it once at the end rather than at every checkpoint.
+  std::uint64_t Count() {
+    std::uint64_t total = 0;
+    FingerprintSet set;
+    std::vector<std::uint64_t> chunk(kBufferedFingerprints);
+    for (std::size_t i = 0; i < buffers_.size(); ++i) {
+      Spill(i);
+      files_[i].flush();
+      std::ifstream in(PartitionPath(i), std::ios::binary);
+      if (!in) {
+        throw std::runtime_error("cannot read " + PartitionPath(i));
+      }
+      set.Clear();
+      while (in.read(reinterpret_cast<char*>(chunk.data()), chunk.size() * sizeof(std::uint64_t)) ||
+             in.gcount() > 0) {
+        const std::size_t n = static_cast<std::size_t>(in.gcount()) / sizeof(std::uint64_t);
+        for (std::size_t j = 0; j < n; ++j) set.Insert(chunk[j]);
+      }
+      total += set.Size();
+    }
+    return total;
+  }
+
+private:
+  std::string directory_;
+  int partitionBits_;
+  WyHash64 hasher_;
+  std::vector<std::vector<std::uint64_t>> buffers_;
+  std::vector<std::ofstream> files_;
+
+  std::string PartitionPath(std::size_t partition) const {
+    return directory_ + "/exact-partition-" + std::to_string(partitionBits_) + "-" +
+           std::to_string(partition) + ".bin";
+  }
+
+  void Spill(std::size_t partition) {
+    std::vector<std::uint64_t>& buffer = buffers_[partition];
+    if (buffer.empty()) return;
+    files_[partition].write(reinterpret_cast<const char*>(buffer.data()),
+                            static_cast<std::streamsize>(buffer.size() * sizeof(std::uint64_t)));
+    if (!files_[partition]) {
+      throw std::runtime_error("cannot write " + PartitionPath(partition));
+    }
+    buffer.clear();
+  }
+};
@@ -1,19 +1,56 @@
 //
 // Created by Диана on 08/02/2026.
 //
+#pragma once
+
+#include <cstddef>
 #include <cstdint>
-#include <string>
+#include <cstring>
+#include <string_view>
+
+// Hashers plug into the sketches as a template parameter and provide:
+//   static constexpr int kBits;          // significant bits of Result, 32 or 64
+//   static constexpr std::uint32_t kId;  // stored in serialized sketches
+//   using Result = ...;                  // std::uint32_t or std::uint64_t
+//   explicit Hasher(std::uint64_t seed);
+//   Result operator()(std::string_view) const;
+//   template <typename Key> void HashBatch(const Key*, std::size_t, Result*) const;
+// HashBatch must return exactly what operator() returns for every key. A
+// plain loop is the right implementation for short keys: consecutive keys
+// are independent, so the CPU already overlaps their hash chains. Hashing
+// four FNV keys in lockstep measured 30-40% slower on the 1-30 byte stream
+// strings because of the ragged tails.
+
 // FNV
 class HashFuncGen {
 public:
-  explicit HashFuncGen(std::uint32_t seed) : seed_(seed) {}
+  static constexpr int kBits = 32;
+  static constexpr std::uint32_t kId = 0;
+  using Result = std::uint32_t;
+
+  explicit HashFuncGen(std::uint64_t seed) : seed_(static_cast<std::uint32_t>(seed)) {}
 
-  std::uint32_t operator()(const std::string& s) const {
+  std::uint32_t operator()(std::string_view s) const {
     std::uint32_t h = 2166136261u ^ seed_;
     for (unsigned char c : s) {
-      h ^= static_cast<std::uint32_t>(c);
-      h *= 16777619u;
+      h = Step(h, c);
     }
+    return Finalize(h);
+  }
+
+  template <typename Key>
+  void HashBatch(const Key* keys, std::size_t count, std::uint32_t* out) const {
+    for (std::size_t i = 0; i < count; ++i) out[i] = (*this)(keys[i]);
+  }
+
+private:
+  std::uint32_t seed_;
+
+  static std::uint32_t Step(std::uint32_t h, unsigned char c) {
+    return (h ^ static_cast<std::uint32_t>(c)) * 16777619u;
+  }
+
+  static std::uint32_t Finalize(std::uint32_t h) {
     h ^= h >> 16;
     h *= 0x7feb352dU;
     h ^= h >> 15;
@@ -21,25 +58,159 @@ public:
     h ^= h >> 16;
     return h;
   }
-
-private:
-  std::uint32_t seed_;
 };
 
+// FNV-1a without a finalizer: its low bits, which pick the register, mix
+// poorly. Kept for reproducing the original results; prefer
+// Finalized<HashFuncGen64> or WyHash64.
 class HashFuncGen64 {
 public:
+  static constexpr int kBits = 64;
+  static constexpr std::uint32_t kId = 0;
+  using Result = std::uint64_t;
+
   explicit HashFuncGen64(std::uint64_t seed) : seed_(seed) {}
 
-  std::uint64_t operator()(const std::string& s) const {
+  std::uint64_t operator()(std::string_view s) const {
     std::uint64_t h = 14695981039346656037ULL ^ seed_;
-    const std::uint64_t prime = 1099511628211ULL;
     for (unsigned char c : s) {
-      h ^= static_cast<std::uint64_t>(c);
-      h *= prime;
+      h = Step(h, c);
     }
     return h;
   }
 
+  template <typename Key>
+  void HashBatch(const Key* keys, std::size_t count, std::uint64_t* out) const {
+    for (std::size_t i = 0; i < count; ++i) out[i] = (*this)(keys[i]);
+  }
+
 private:
   std::uint64_t seed_;
-};
\ No newline at end of file
+
+  static std::uint64_t Step(std::uint64_t h, unsigned char c) {
+    return (h ^ static_cast<std::uint64_t>(c)) * 1099511628211ULL;
+  }
+};
+
+// MurmurHash3's fmix64: every input bit affects every output bit with
+// probability close to 1/2.
+inline std::uint64_t Mix64(std::uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// Any 64-bit hasher followed by Mix64.
+template <typename Base>
+class Finalized {
+public:
+  static constexpr int kBits = 64;
+  static constexpr std::uint32_t kId = Base::kId | 0x100u;
+  using Result = std::uint64_t;
+
+  explicit Finalized(std::uint64_t seed) : base_(seed) {}
+
+  std::uint64_t operator()(std::string_view s) const { return Mix64(base_(s)); }
+
+  template <typename Key>
+  void HashBatch(const Key* keys, std::size_t count, std::uint64_t* out) const {
+    base_.HashBatch(keys, count, out);
+    for (std::size_t i = 0; i < count; ++i) out[i] = Mix64(out[i]);
+  }
+
+private:
+  Base base_;
+};
+
+// wyhash-style hash: reads 8 bytes (or two overlapping 4-byte words) at a
+// time and mixes with 64x64->128-bit multiplies, three independent lanes for
+// long inputs. Short keys, like the 1-30 character stream strings, take one
+// or two multiplies instead of one per byte.
+class WyHash64 {
+public:
+  static constexpr int kBits = 64;
+  static constexpr std::uint32_t kId = 1;
+  using Result = std::uint64_t;
+
+  explicit WyHash64(std::uint64_t seed) : seed_(seed ^ Mix(seed ^ kSecret[0], kSecret[1])) {}
+
+  std::uint64_t operator()(std::string_view s) const {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(s.data());
+    std::size_t len = s.size();
+    std::uint64_t seed = seed_;
+    std::uint64_t a = 0;
+    std::uint64_t b = 0;
+    if (len <= 16) {
+      if (len >= 4) {
+        const std::size_t shift = (len >> 3) << 2;
+        a = (Read4(p) << 32) | Read4(p + shift);
+        b = (Read4(p + len - 4) << 32) | Read4(p + len - 4 - shift);
+      } else if (len > 0) {
+        a = (static_cast<std::uint64_t>(p[0]) << 16) | (static_cast<std::uint64_t>(p[len >> 1]) << 8) |
+            p[len - 1];
+      }
+    } else {
+      std::size_t i = len;
+      if (i > 48) {
+        std::uint64_t seed1 = seed;
+        std::uint64_t seed2 = seed;
+        do {
+          seed = Mix(Read8(p) ^ kSecret[1], Read8(p + 8) ^ seed);
+          seed1 = Mix(Read8(p + 16) ^ kSecret[2], Read8(p + 24) ^ seed1);
+          seed2 = Mix(Read8(p + 32) ^ kSecret[3], Read8(p + 40) ^ seed2);
+          p += 48;
+          i -= 48;
+        } while (i > 48);
+        seed ^= seed1 ^ seed2;
+      }
+      while (i > 16) {
+        seed = Mix(Read8(p) ^ kSecret[1], Read8(p + 8) ^ seed);
+        p += 16;
+        i -= 16;
+      }
+      a = Read8(p + i - 16);
+      b = Read8(p + i - 8);
+    }
+    a ^= kSecret[1];
+    b ^= seed;
+    Multiply(a, b);
+    return Mix(a ^ kSecret[0] ^ len, b ^ kSecret[1]);
+  }
+
+  template <typename Key>
+  void HashBatch(const Key* keys, std::size_t count, std::uint64_t* out) const {
+    for (std::size_t i = 0; i < count; ++i) out[i] = (*this)(keys[i]);
+  }
+
+private:
+  static constexpr std::uint64_t kSecret[4] = {0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+                                               0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL};
+
+  std::uint64_t seed_;
+
+  static void Multiply(std::uint64_t& a, std::uint64_t& b) {
+    const unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+    a = static_cast<std::uint64_t>(r);
+    b = static_cast<std::uint64_t>(r >> 64);
+  }
+
+  static std::uint64_t Mix(std::uint64_t a, std::uint64_t b) {
+    Multiply(a, b);
+    return a ^ b;
+  }
+
+  static std::uint64_t Read8(const unsigned char* p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  static std::uint64_t Read4(const unsigned char* p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+};
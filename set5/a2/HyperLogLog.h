@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Estimators.h"
+#include "HashFuncGen.h"
+#include "RegisterStore.h"
+
+// HyperLogLog with 2^Precision registers. The policies choose the hash
+// function (see HashFuncGen.h), the register layout (SparseThenPacked or
+// Packed, see RegisterStore.h) and the estimator (ClassicEstimator or
+// ImprovedEstimator, see Estimators.h). The precision is part of the type,
+// so the register count is a compile-time constant and sketches of
+// different precisions cannot be mixed up by accident.
+template <typename Hasher = WyHash64, int Precision = 12, typename RegisterLayout = SparseThenPacked,
+          typename Estimator = ImprovedEstimator>
+class HyperLogLog {
+  static_assert(Precision >= 4 && Precision <= 24, "precision must be in [4, 24]");
+
+public:
+  static constexpr int kHashBits = Hasher::kBits;
+  static constexpr int kIndexBitCount = Precision;
+  static constexpr std::uint32_t kRegisterCount = 1u << Precision;
+  static constexpr std::size_t kBatchSize = 64;
+
+  explicit HyperLogLog(std::uint64_t hashSeed)
+      : store_(Precision, kHashBits, RegisterLayout::kStartSparse),
+        hashSeed_(hashSeed),
+        hasher_(hashSeed) {}
+
+  void Add(std::string_view value) {
+    store_.Insert(hasher_(value));
+  }
+
+  // Adds a hash computed by the caller with this sketch's hasher and seed.
+  void AddHash(typename Hasher::Result hash) {
+    store_.Insert(hash);
+  }
+
+  // Adds count keys (anything convertible to std::string_view), hashing
+  // them kBatchSize at a time before touching the registers.
+  template <typename Key>
+  void AddBatch(const Key* keys, std::size_t count) {
+    typename Hasher::Result hashes[kBatchSize];
+    for (std::size_t begin = 0; begin < count; begin += kBatchSize) {
+      const std::size_t n = std::min(kBatchSize, count - begin);
+      hasher_.HashBatch(keys + begin, n, hashes);
+      store_.InsertBatch(hashes, n);
+    }
+  }
+
+  double Estimate() const {
+    if (store_.IsSparse()) return store_.SparseEstimate();
+    return EstimateFromHistogram(store_.Registers().Histogram());
+  }
+
+  // Estimate of 2^Precision dense registers given as a histogram of their
+  // values, e.g. of the register-wise max of several sketches.
+  static double EstimateFromHistogram(const std::array<std::uint32_t, 64>& histogram) {
+    return Estimator::template Estimate<Precision, kHashBits>(histogram);
+  }
+
+  int IndexBitCount() const { return Precision; }
+  std::uint64_t HashSeed() const { return hashSeed_; }
+  const RegisterStore& Registers() const { return store_; }
+
+  // The sketch that would have been built at precision Coarser from the
+  // same stream.
+  template <int Coarser>
+  HyperLogLog<Hasher, Coarser, RegisterLayout, Estimator> FoldDown() const {
+    static_assert(Coarser <= Precision, "FoldDown cannot add index bits");
+    HyperLogLog<Hasher, Coarser, RegisterLayout, Estimator> folded(hashSeed_);
+    folded.store_ = store_;
+    folded.store_.FoldDown(Coarser);
+    return folded;
+  }
+
+  // Register-wise max with another sketch of the same hash seed and at
+  // least this precision; a finer sketch is folded down on the fly.
+  template <int OtherPrecision>
+  void Merge(const HyperLogLog<Hasher, OtherPrecision, RegisterLayout, Estimator>& other) {
+    static_assert(OtherPrecision >= Precision, "merge into the coarser sketch");
+    CheckCompatible(kHashBits, Hasher::kId, other.hashSeed_);
+    store_.Merge(other.store_);
+  }
+
+  void Merge(const SketchView& view) {
+    CheckCompatible(view.HashBits(), view.HasherId(), view.HashSeed());
+    if (view.IndexBitCount() < Precision) {
+      throw std::invalid_argument("cannot merge a sketch of lower precision");
+    }
+    store_.Merge(view);
+  }
+
+  std::vector<std::uint8_t> Serialize() const {
+    return store_.Serialize(Hasher::kId, hashSeed_);
+  }
+
+  // Accepts serialized sketches of this or a higher precision.
+  static HyperLogLog Deserialize(const std::uint8_t* data, std::size_t size) {
+    const SketchView view(data, size);
+    HyperLogLog sketch(view.HashSeed());
+    sketch.Merge(view);
+    return sketch;
+  }
+
+private:
+  template <typename, int, typename, typename>
+  friend class HyperLogLog;
+
+  RegisterStore store_;
+  std::uint64_t hashSeed_;
+  Hasher hasher_;
+
+  void CheckCompatible(int hashBits, std::uint32_t hasherId, std::uint64_t hashSeed) const {
+    if (hashBits != kHashBits || hasherId != Hasher::kId || hashSeed != hashSeed_) {
+      throw std::invalid_argument("cannot merge sketches built with different hash functions");
+    }
+  }
+};
+
+// The original HyperLogLog: 32-bit FNV and the classic estimator.
+template <typename Hasher = HashFuncGen, int Precision = 12>
+using ClassicHyperLogLog = HyperLogLog<Hasher, Precision, SparseThenPacked, ClassicEstimator>;
+
+template <typename Hasher = WyHash64, int Precision = 12>
+using HyperLogLogUltraMax = HyperLogLog<Hasher, Precision, SparseThenPacked, ImprovedEstimator>;
+
+// Median of K HyperLogLog sketches. Every key is hashed once; member 0
+// takes that hash and member i > 0 a Mix64 remix of it with a per-member
+// constant, so the members see independent-looking hashes at the cost of
+// one multiply-xorshift each rather than K full hashes.
+//
+// The median damps a single unlucky sketch, but for the same memory one
+// sketch of K * 2^Precision registers is more accurate: its relative error
+// is 1.04 / sqrt(K m), while the median of K sketches of m registers gets
+// about 1.25 times that. The ensemble is for when the members are wanted
+// on their own too, e.g. as K independent estimates for an interval.
+template <int K, typename Hasher = WyHash64, int Precision = 12, typename RegisterLayout = SparseThenPacked,
+          typename Estimator = ImprovedEstimator>
+class MedianHyperLogLog {
+  static_assert(K >= 1, "an ensemble needs at least one sketch");
+
+public:
+  using Sketch = HyperLogLog<Hasher, Precision, RegisterLayout, Estimator>;
+  static constexpr std::size_t kBatchSize = Sketch::kBatchSize;
+
+  explicit MedianHyperLogLog(std::uint64_t hashSeed)
+      : members_(MakeMembers(hashSeed)),
+        hasher_(hashSeed) {}
+
+  void Add(std::string_view value) {
+    AddHash(hasher_(value));
+  }
+
+  template <typename Key>
+  void AddBatch(const Key* keys, std::size_t count) {
+    typename Hasher::Result hashes[kBatchSize];
+    for (std::size_t begin = 0; begin < count; begin += kBatchSize) {
+      const std::size_t n = std::min(kBatchSize, count - begin);
+      hasher_.HashBatch(keys + begin, n, hashes);
+      for (std::size_t i = 0; i < n; ++i) AddHash(hashes[i]);
+    }
+  }
+
+  double Estimate() const {
+    std::array<double, K> estimates;
+    for (int i = 0; i < K; ++i) estimates[i] = members_[i].Estimate();
+    std::nth_element(estimates.begin(), estimates.begin() + K / 2, estimates.end());
+    if (K % 2 == 1) return estimates[K / 2];
+    const double upper = estimates[K / 2];
+    const double lower = *std::max_element(estimates.begin(), estimates.begin() + K / 2);
+    return 0.5 * (lower + upper);
+  }
+
+  void Merge(const MedianHyperLogLog& other) {
+    for (int i = 0; i < K; ++i) members_[i].Merge(other.members_[i]);
+  }
+
+  // Estimate of member i alone. The members are not handed out as sketches:
+  // all of them carry the ensemble's hash seed, but members i > 0 hold
+  // remixed hashes, so serializing or merging one would pass the hasher
+  // checks of a plain sketch with that seed and silently mix two hash
+  // functions.
+  double MemberEstimate(int i) const { return members_[i].Estimate(); }
+
+private:
+  std::array<Sketch, K> members_;
+  Hasher hasher_;
+
+  static constexpr std::uint64_t kMemberStep = 0x9E3779B97F4A7C15ULL;
+
+  void AddHash(typename Hasher::Result hash) {
+    members_[0].AddHash(hash);
+    for (int i = 1; i < K; ++i) {
+      members_[i].AddHash(static_cast<typename Hasher::Result>(
+          Mix64(static_cast<std::uint64_t>(hash) ^ (static_cast<std::uint64_t>(i) * kMemberStep))));
+    }
+  }
+
+  template <std::size_t... I>
+  static std::array<Sketch, K> MakeMembers(std::uint64_t hashSeed, std::index_sequence<I...>) {
+    return {{(static_cast<void>(I), Sketch(hashSeed))...}};
+  }
+
+  static std::array<Sketch, K> MakeMembers(std::uint64_t hashSeed) {
+    return MakeMembers(hashSeed, std::make_index_sequence<K>());
+  }
+};
@@ -0,0 +1,73 @@
+// Ingest throughput of one-at-a-time Add, AddBatch and AddParallel.
+//
+//   g++ -std=c++17 -O2 -pthread IngestBenchmark.cpp -o ingest_benchmark
+//   ./ingest_benchmark [keys] [threads]
+//
+// All three paths must produce the same registers; the benchmark checks
+// that by comparing the serialized sketches.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "HyperLogLog.h"
+#include "ParallelIngest.h"
+#include "RandomStreamGen.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double MillionKeysPerSecond(Clock::time_point begin, Clock::time_point end, std::size_t keys) {
+  return static_cast<double>(keys) / std::chrono::duration<double, std::micro>(end - begin).count();
+}
+
+template <typename Sketch>
+void Run(const char* name, const std::vector<std::string_view>& keys, int threads) {
+  const std::uint64_t seed = 1;
+  Sketch single(seed);
+  auto begin = Clock::now();
+  for (std::string_view key : keys) single.Add(key);
+  const double addRate = MillionKeysPerSecond(begin, Clock::now(), keys.size());
+
+  Sketch batch(seed);
+  begin = Clock::now();
+  batch.AddBatch(keys.data(), keys.size());
+  const double batchRate = MillionKeysPerSecond(begin, Clock::now(), keys.size());
+
+  Sketch parallel(seed);
+  begin = Clock::now();
+  AddParallel(parallel, keys.data(), keys.size(), threads);
+  const double parallelRate = MillionKeysPerSecond(begin, Clock::now(), keys.size());
+
+  const bool same = single.Serialize() == batch.Serialize() && batch.Serialize() == parallel.Serialize();
+  std::printf("%-20s p=%-3d %10.1f %10.1f %10.1f   %s\n", name, Sketch::kIndexBitCount, addRate, batchRate,
+              parallelRate, same ? "identical" : "MISMATCH");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::size_t keyCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+  const int threads = argc > 2 ? std::atoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency());
+
+  RandomStreamGen generator(11);
+  const std::vector<std::string> storage = generator.generate(keyCount);
+  const std::vector<std::string_view> keys(storage.begin(), storage.end());
+
+  std::printf("%zu keys, %d threads, million keys per second\n", keyCount, threads);
+  std::printf("%-26s %10s %10s %10s\n", "", "Add", "AddBatch", "parallel");
+  Run<ClassicHyperLogLog<HashFuncGen, 12>>("ClassicHyperLogLog", keys, threads);
+  Run<HyperLogLogUltraMax<WyHash64, 12>>("HyperLogLogUltraMax", keys, threads);
+  Run<ClassicHyperLogLog<HashFuncGen, 16>>("ClassicHyperLogLog", keys, threads);
+  Run<HyperLogLogUltraMax<WyHash64, 16>>("HyperLogLogUltraMax", keys, threads);
+  Run<ClassicHyperLogLog<HashFuncGen, 20>>("ClassicHyperLogLog", keys, threads);
+  Run<HyperLogLogUltraMax<WyHash64, 20>>("HyperLogLogUltraMax", keys, threads);
+  return 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Adds count keys to sketch on several threads. Every thread fills its own
+// copy of sketch with one contiguous slice through AddBatch, and the copies
+// are max-merged back at the end. Register max is idempotent, so starting
+// each copy from the current sketch instead of an empty one changes nothing
+// and keeps the hash function and precision without extra parameters.
+template <typename Sketch, typename Key>
+void AddParallel(Sketch& sketch, const Key* keys, std::size_t count,
+                 int threads = static_cast<int>(std::thread::hardware_concurrency())) {
+  // Below this many keys per thread, copying and merging costs more than it saves.
+  const std::size_t minSlice = 1 << 16;
+  const std::size_t threadCount = std::max<std::size_t>(
+      1, std::min<std::size_t>(static_cast<std::size_t>(std::max(threads, 1)), count / minSlice));
+  if (threadCount == 1) {
+    sketch.AddBatch(keys, count);
+    return;
+  }
+
+  std::vector<Sketch> locals(threadCount, sketch);
+  std::vector<std::thread> pool;
+  const std::size_t slice = (count + threadCount - 1) / threadCount;
+  for (std::size_t t = 0; t < threadCount; ++t) {
+    const std::size_t begin = std::min(count, t * slice);
+    const std::size_t end = std::min(count, begin + slice);
+    pool.emplace_back([&locals, keys, t, begin, end]() { locals[t].AddBatch(keys + begin, end - begin); });
+  }
+  for (std::thread& thread : pool) thread.join();
+  for (const Sketch& local : locals) sketch.Merge(local);
+}
@@ -1,14 +1,26 @@
 //
 // Created by Диана on 08/02/2026.
 //
+#pragma once
+
 #include <string>
+#include <string_view>
 #include <vector>
 #include <random>
 #include <cstddef>
 
 class RandomStreamGen {
 public:
-  explicit RandomStreamGen(std::uint64_t seed): rng_(seed), lenDist(1, 30),
+  static constexpr int kMaxLength = 30;
+
+  // Keys of one chunk, back to back in one buffer. The views stay valid
+  // until the chunk is refilled.
+  struct Chunk {
+    std::vector<char> bytes;
+    std::vector<std::string_view> keys;
+  };
+
+  explicit RandomStreamGen(std::uint64_t seed): rng_(seed), lenDist(1, kMaxLength),
         charDist(0, static_cast<int>(alphabet.size()) - 1) {}
 
   std::string next() {
@@ -30,6 +42,24 @@ public:
     return v;
   }
 
+  // Fills chunk with the next count keys: the same keys, in the same order,
+  // as count calls to next(). A chunk reused for equal or smaller counts
+  // keeps its buffers, so streaming any number of keys allocates nothing
+  // per key.
+  void nextChunk(std::size_t count, Chunk& chunk) {
+    chunk.bytes.resize(count * kMaxLength);
+    chunk.keys.resize(count);
+    char* out = chunk.bytes.data();
+    for (std::size_t i = 0; i < count; ++i) {
+      const int len = lenDist(rng_);
+      char* begin = out;
+      for (int j = 0; j < len; ++j) {
+        *out++ = alphabet[charDist(rng_)];
+      }
+      chunk.keys[i] = std::string_view(begin, static_cast<std::size_t>(len));
+    }
+  }
+
   static std::size_t prefixByPercent(std::size_t N, int percent) {
     return (N * static_cast<std::size_t>(percent)) / 100;
   }
@@ -0,0 +1,685 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Sketch wire format, version 1 (native byte order):
+//   SketchHeader (24 bytes), then payloadSize bytes of registers.
+// encoding 0: 2^indexBitCount registers, one byte each.
+// encoding 2: 2^indexBitCount six-bit registers packed as in PackedRegisters.
+// encoding 1: sparse list, varint deltas of sorted (index << 6 | rho) keys at
+//             RegisterStore::kSparseIndexBits index bits.
+// Sketches can only be merged when they were built with the same hash
+// function (hashBits, hasherId) and seed. hasherId is the hasher's kId; it
+// was a zero reserved field before hashers became pluggable, and 0 still
+// means FNV.
+struct SketchHeader {
+  char magic[4];
+  std::uint8_t version;
+  std::uint8_t hashBits;
+  std::uint8_t indexBitCount;
+  std::uint8_t encoding;
+  std::uint32_t payloadSize;
+  std::uint32_t hasherId;
+  std::uint64_t hashSeed;
+};
+
+static_assert(sizeof(SketchHeader) == 24, "SketchHeader must stay 24 bytes");
+
+namespace hll_detail {
+
+constexpr std::uint8_t kFormatVersion = 1;
+constexpr std::uint8_t kEncodingDenseBytes = 0;
+constexpr std::uint8_t kEncodingSparse = 1;
+constexpr std::uint8_t kEncodingDensePacked6 = 2;
+// Index bits of the keys of a sparse list.
+constexpr int kSparseIndexBits = 25;
+
+struct InversePowersOfTwo {
+  double values[64];
+  constexpr InversePowersOfTwo() : values() {
+    double v = 1.0;
+    for (int k = 0; k < 64; ++k) {
+      values[k] = v;
+      v /= 2.0;
+    }
+  }
+};
+
+// kInversePowers.values[k] == 2^-k for every possible register value.
+constexpr InversePowersOfTwo kInversePowers;
+
+// Number of leading zeros + 1 in the rho window, bits hashBits-1 .. fromBit of
+// hash, capped at window + 1 when the whole window is zero.
+inline int Rho(std::uint64_t hash, int fromBit, int hashBits) {
+  const int window = hashBits - fromBit;
+  const std::uint64_t w = (hash >> fromBit) << (64 - window);
+  if (w == 0u) return window + 1;
+  return __builtin_clzll(w) + 1;
+}
+
+// rho of a register after dropping index bits coarseBits..fineBits-1. Those
+// bits sit right below the fine rho window, so a saturated fine register
+// keeps counting zeros inside them.
+inline std::uint8_t FoldRegister(std::uint32_t fineIndex, std::uint8_t fineRho,
+                                 int fineBits, int coarseBits, int hashBits) {
+  const int fineMaxRho = hashBits - fineBits + 1;
+  if (fineRho < fineMaxRho) return fineRho;
+
+  const std::uint32_t dropped = fineIndex >> coarseBits;
+  if (dropped == 0u) return static_cast<std::uint8_t>(hashBits - coarseBits + 1);
+  const int droppedBits = fineBits - coarseBits;
+  const int leadingZeros = droppedBits - (32 - __builtin_clz(dropped));
+  return static_cast<std::uint8_t>(hashBits - fineBits + leadingZeros + 1);
+}
+
+inline void AppendVarint(std::vector<std::uint8_t>& out, std::uint32_t value) {
+  while (value >= 0x80u) {
+    out.push_back(static_cast<std::uint8_t>(value | 0x80u));
+    value >>= 7;
+  }
+  out.push_back(static_cast<std::uint8_t>(value));
+}
+
+// Calls f(key) for every key of a sparse list.
+template <typename F>
+void ForEachSparseKey(const std::uint8_t* data, std::size_t size, F f) {
+  std::uint32_t key = 0;
+  std::size_t pos = 0;
+  while (pos < size) {
+    std::uint32_t delta = 0;
+    int shift = 0;
+    std::uint8_t byte;
+    do {
+      if (pos >= size || shift > 28) {
+        throw std::invalid_argument("malformed sparse register list");
+      }
+      byte = data[pos++];
+      delta |= static_cast<std::uint32_t>(byte & 0x7Fu) << shift;
+      shift += 7;
+    } while (byte & 0x80u);
+    key += delta;
+    f(key);
+  }
+}
+
+}  // namespace hll_detail
+
+// Zero-copy view of one serialized sketch, e.g. inside a memory-mapped file
+// of concatenated sketches. The buffer must outlive the view.
+class SketchView {
+public:
+  SketchView(const std::uint8_t* data, std::size_t size) {
+    if (size < sizeof(SketchHeader)) {
+      throw std::invalid_argument("sketch buffer is shorter than its header");
+    }
+    std::memcpy(&header_, data, sizeof(header_));
+    if (std::memcmp(header_.magic, "HLLS", 4) != 0) {
+      throw std::invalid_argument("not a HyperLogLog sketch");
+    }
+    if (header_.version != hll_detail::kFormatVersion) {
+      throw std::invalid_argument("unsupported sketch format version " +
+                                  std::to_string(header_.version));
+    }
+    // The ranges come first: the expected payload sizes below shift by
+    // indexBitCount.
+    if (header_.indexBitCount < 4 || header_.indexBitCount > 24 ||
+        (header_.hashBits != 32 && header_.hashBits != 64)) {
+      throw std::invalid_argument("malformed sketch header");
+    }
+    const bool validDense = header_.encoding == hll_detail::kEncodingDenseBytes &&
+                            header_.payloadSize == (1u << header_.indexBitCount);
+    const bool validPacked = header_.encoding == hll_detail::kEncodingDensePacked6 &&
+                             header_.payloadSize == (3u << header_.indexBitCount) / 4u;
+    const bool validSparse = header_.encoding == hll_detail::kEncodingSparse;
+    if (!(validDense || validPacked || validSparse)) {
+      throw std::invalid_argument("malformed sketch header");
+    }
+    if (size - sizeof(SketchHeader) < header_.payloadSize) {
+      throw std::invalid_argument("sketch payload is truncated");
+    }
+    payload_ = data + sizeof(SketchHeader);
+    if (validSparse) CheckSparseKeys();
+  }
+
+  int HashBits() const { return header_.hashBits; }
+  std::uint32_t HasherId() const { return header_.hasherId; }
+  int IndexBitCount() const { return header_.indexBitCount; }
+  std::uint64_t HashSeed() const { return header_.hashSeed; }
+  int Encoding() const { return header_.encoding; }
+  const std::uint8_t* Payload() const { return payload_; }
+  std::size_t PayloadSize() const { return header_.payloadSize; }
+
+  // Bytes taken by this sketch; the next concatenated sketch starts there.
+  std::size_t SerializedSize() const { return sizeof(SketchHeader) + header_.payloadSize; }
+
+private:
+  SketchHeader header_;
+  const std::uint8_t* payload_ = nullptr;
+
+  // Every key needs a sparse index of kSparseIndexBits bits and a rho that
+  // the hash can produce. A zero rho in particular would be taken for an
+  // empty slot once the key is buffered.
+  void CheckSparseKeys() const {
+    const std::uint32_t maxRho = static_cast<std::uint32_t>(header_.hashBits - hll_detail::kSparseIndexBits + 1);
+    hll_detail::ForEachSparseKey(payload_, header_.payloadSize, [maxRho](std::uint32_t key) {
+      const std::uint32_t rho = key & 63u;
+      if ((key >> 6) >= (1u << hll_detail::kSparseIndexBits) || rho == 0u || rho > maxRho) {
+        throw std::invalid_argument("malformed sparse register list");
+      }
+    });
+  }
+};
+
+// 2^p registers of six bits each, four to a little-endian group of three
+// bytes. Six bits hold every rho of a 64-bit hash, so this is lossless and
+// takes 3/4 of the one-byte layout. A histogram of register values is kept
+// up to date on every write, so estimating never rescans the registers. The
+// histogram is allocated with the registers, so an empty PackedRegisters (as
+// held by every sparse store) costs only its members.
+class PackedRegisters {
+public:
+  struct Sums {
+    double harmonicSum;
+    std::uint32_t zeroCount;
+  };
+
+  using Histogram64 = std::array<std::uint32_t, 64>;
+
+  PackedRegisters() = default;
+  explicit PackedRegisters(int indexBitCount)
+      : count_(1u << indexBitCount),
+        bytes_(ByteSize(indexBitCount), 0),
+        histogram_(std::make_unique<Histogram64>()) {
+    (*histogram_)[0] = count_;
+  }
+
+  PackedRegisters(const PackedRegisters& other)
+      : count_(other.count_),
+        bytes_(other.bytes_),
+        histogram_(other.histogram_ ? std::make_unique<Histogram64>(*other.histogram_) : nullptr) {}
+
+  PackedRegisters& operator=(const PackedRegisters& other) {
+    if (this != &other) *this = PackedRegisters(other);
+    return *this;
+  }
+
+  PackedRegisters(PackedRegisters&&) noexcept = default;
+  PackedRegisters& operator=(PackedRegisters&&) noexcept = default;
+
+  static std::size_t ByteSize(int indexBitCount) {
+    return (static_cast<std::size_t>(3) << indexBitCount) / 4;
+  }
+
+  // MemoryUsage() of the registers at this precision.
+  static std::size_t MemoryUsage(int indexBitCount) {
+    return ByteSize(indexBitCount) + sizeof(Histogram64);
+  }
+
+  static std::uint8_t Load(const std::uint8_t* data, std::uint32_t i) {
+    return static_cast<std::uint8_t>((LoadGroup(data + 3 * (i / 4)) >> (6 * (i % 4))) & 63u);
+  }
+
+  std::uint32_t Size() const { return count_; }
+  const std::uint8_t* Data() const { return bytes_.data(); }
+  std::size_t ByteCount() const { return bytes_.size(); }
+  // Heap bytes held by the registers and their histogram.
+  std::size_t MemoryUsage() const {
+    return bytes_.capacity() + (histogram_ ? sizeof(Histogram64) : 0);
+  }
+
+  std::uint8_t operator[](std::uint32_t i) const { return Load(bytes_.data(), i); }
+
+  void Prefetch(std::uint32_t i) const {
+    __builtin_prefetch(bytes_.data() + 3 * (i / 4), 1);
+  }
+
+  void SetMax(std::uint32_t i, std::uint8_t value) {
+    std::uint8_t* group = bytes_.data() + 3 * (i / 4);
+    const int shift = 6 * static_cast<int>(i % 4);
+    std::uint32_t w = LoadGroup(group);
+    const std::uint32_t old = (w >> shift) & 63u;
+    if (old >= value) return;
+    --(*histogram_)[old];
+    ++(*histogram_)[value];
+    w = (w & ~(63u << shift)) | (static_cast<std::uint32_t>(value) << shift);
+    group[0] = static_cast<std::uint8_t>(w);
+    group[1] = static_cast<std::uint8_t>(w >> 8);
+    group[2] = static_cast<std::uint8_t>(w >> 16);
+  }
+
+  // histogram[k] is the number of registers equal to k; all zero when no
+  // registers are allocated.
+  const Histogram64& Histogram() const {
+    static const Histogram64 kEmpty{};
+    return histogram_ ? *histogram_ : kEmpty;
+  }
+
+  // Sum of 2^-register and number of zero registers, from the histogram in
+  // 64 steps regardless of the register count.
+  Sums ComputeSums() const { return SumsOf(Histogram()); }
+
+  // The same for any register histogram. Summing from the highest value
+  // down adds the small terms first.
+  static Sums SumsOf(const std::array<std::uint32_t, 64>& histogram) {
+    const double* inverse = hll_detail::kInversePowers.values;
+    double sum = 0.0;
+    for (int k = 63; k >= 0; --k) {
+      sum += static_cast<double>(histogram[k]) * inverse[k];
+    }
+    return {sum, histogram[0]};
+  }
+
+
+  // Histogram of the register-wise max of two register arrays of the same
+  // size, unpacked group by group without materializing the union.
+  static std::array<std::uint32_t, 64> MaxHistogram(const PackedRegisters& a, const PackedRegisters& b) {
+    std::array<std::uint32_t, 64> histogram{};
+    const std::uint8_t* pa = a.bytes_.data();
+    const std::uint8_t* pb = b.bytes_.data();
+    for (std::size_t g = 0; g < a.bytes_.size(); g += 3) {
+      const std::uint32_t wa = LoadGroup(pa + g);
+      const std::uint32_t wb = LoadGroup(pb + g);
+      for (int lane = 0; lane < 4; ++lane) {
+        ++histogram[std::max((wa >> (6 * lane)) & 63u, (wb >> (6 * lane)) & 63u)];
+      }
+    }
+    return histogram;
+  }
+
+private:
+  std::uint32_t count_ = 0;
+  std::vector<std::uint8_t> bytes_;
+  std::unique_ptr<Histogram64> histogram_;
+
+  static std::uint32_t LoadGroup(const std::uint8_t* group) {
+    return static_cast<std::uint32_t>(group[0]) | (static_cast<std::uint32_t>(group[1]) << 8) |
+           (static_cast<std::uint32_t>(group[2]) << 16);
+  }
+};
+
+// Register layouts for HyperLogLog. SparseThenPacked starts as the sparse
+// list below and converts to packed registers when that saves space; Packed
+// allocates the packed registers up front, which keeps Add branch-free for
+// sketches that will be large anyway.
+struct SparseThenPacked {
+  static constexpr bool kStartSparse = true;
+};
+
+struct Packed {
+  static constexpr bool kStartSparse = false;
+};
+
+// Registers of one sketch. A new store is sparse: it keeps (index, rho) pairs
+// at kSparseIndexBits of precision as a sorted, varint-compressed list plus a
+// small hash table of recent inserts, keyed by sparse index. The table only
+// grows while the list, its skip index and the table together stay within
+// the heap of the dense registers and their histogram; once the list alone
+// leaves no room for a minimal table the store is converted, exactly, into
+// 2^p packed six-bit registers. Tiny sketches therefore cost a few bytes
+// instead of 2^p, and their cardinality comes from linear counting over 2^25
+// buckets. The number of distinct sparse indices is kept up to date on every
+// insert, so a sparse estimate is O(1) and never touches the list.
+class RegisterStore {
+public:
+  static constexpr int kSparseIndexBits = hll_detail::kSparseIndexBits;
+  static constexpr std::size_t kMinBufferSlots = 16;
+  // One list entry in kSkipStride is indexed for membership tests.
+  static constexpr std::size_t kSkipStride = 16;
+
+  RegisterStore(int indexBitCount, int hashBits, bool startSparse = true)
+      : indexBitCount_(indexBitCount),
+        hashBits_(hashBits),
+        sparse_(startSparse && indexBitCount < kSparseIndexBits) {
+    if (!sparse_) registers_ = PackedRegisters(indexBitCount_);
+  }
+
+  int IndexBitCount() const { return indexBitCount_; }
+  int HashBits() const { return hashBits_; }
+  bool IsSparse() const { return sparse_; }
+
+  // Dense registers; only meaningful when !IsSparse().
+  const PackedRegisters& Registers() const { return registers_; }
+
+  // Heap bytes held by the registers.
+  std::size_t MemoryUsage() const {
+    return registers_.MemoryUsage() + sparseList_.capacity() +
+           listSkips_.capacity() * sizeof(SparseSkip) + buffer_.capacity() * sizeof(std::uint32_t);
+  }
+
+  void Insert(std::uint64_t hash) {
+    if (sparse_) {
+      const std::uint32_t index = static_cast<std::uint32_t>(hash) & ((1u << kSparseIndexBits) - 1u);
+      const int rho = hll_detail::Rho(hash, kSparseIndexBits, hashBits_);
+      InsertSparseKey((index << 6) | static_cast<std::uint32_t>(rho));
+      return;
+    }
+    const std::uint32_t index = static_cast<std::uint32_t>(hash) & (registerCount() - 1u);
+    registers_.SetMax(index, static_cast<std::uint8_t>(hll_detail::Rho(hash, indexBitCount_, hashBits_)));
+  }
+
+  // Inserts a batch of hashes. In dense mode the register groups of the
+  // whole batch are prefetched before any of them is updated, so cache
+  // misses on large register arrays overlap.
+  template <typename Hash>
+  void InsertBatch(const Hash* hashes, std::size_t count) {
+    if (sparse_) {
+      for (std::size_t i = 0; i < count; ++i) Insert(hashes[i]);
+      return;
+    }
+    const std::uint32_t mask = registerCount() - 1u;
+    for (std::size_t i = 0; i < count; ++i) {
+      registers_.Prefetch(static_cast<std::uint32_t>(hashes[i]) & mask);
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      registers_.SetMax(static_cast<std::uint32_t>(hashes[i]) & mask,
+                        static_cast<std::uint8_t>(hll_detail::Rho(hashes[i], indexBitCount_, hashBits_)));
+    }
+  }
+
+  // Linear counting over the 2^kSparseIndexBits sparse buckets.
+  double SparseEstimate() const {
+    const double m = static_cast<double>(1u << kSparseIndexBits);
+    return m * std::log(m / (m - static_cast<double>(sparseCount_)));
+  }
+
+  void FoldDown(int newIndexBitCount) {
+    if (newIndexBitCount >= indexBitCount_) return;
+    if (sparse_) {
+      indexBitCount_ = newIndexBitCount;
+      return;
+    }
+    PackedRegisters folded(newIndexBitCount);
+    MergeDense(folded, newIndexBitCount, registers_, indexBitCount_);
+    registers_ = std::move(folded);
+    indexBitCount_ = newIndexBitCount;
+  }
+
+  // Register-wise max; the result takes the lower of the two precisions.
+  void Merge(const RegisterStore& other) {
+    if (&other == this) return;
+    FoldDown(other.indexBitCount_);
+    if (other.sparse_) {
+      MergeSparse(other.sparseList_.data(), other.sparseList_.size());
+      for (std::uint32_t key : other.buffer_) {
+        if (key != 0u) AddSparseKey(key);
+      }
+      return;
+    }
+    if (sparse_) ToDense();
+    MergeDense(registers_, indexBitCount_, other.registers_, other.indexBitCount_);
+  }
+
+  void Merge(const SketchView& view) {
+    FoldDown(view.IndexBitCount());
+    if (view.Encoding() == hll_detail::kEncodingSparse) {
+      MergeSparse(view.Payload(), view.PayloadSize());
+      return;
+    }
+    if (sparse_) ToDense();
+    const std::uint8_t* payload = view.Payload();
+    if (view.Encoding() == hll_detail::kEncodingDensePacked6) {
+      MergeDense(registers_, indexBitCount_,
+                 [payload](std::uint32_t i) { return PackedRegisters::Load(payload, i); },
+                 view.IndexBitCount());
+    } else {
+      MergeDense(registers_, indexBitCount_, [payload](std::uint32_t i) { return payload[i]; },
+                 view.IndexBitCount());
+    }
+  }
+
+  std::vector<std::uint8_t> Serialize(std::uint32_t hasherId, std::uint64_t hashSeed) const {
+    // Buffered keys are merged into a copy of the list; the store itself is
+    // left as it is, so concurrent readers are safe.
+    std::vector<std::uint8_t> merged;
+    if (sparse_ && bufferSize_ > 0) {
+      MergeIntoList(sparseList_, SortedBufferKeys(), merged, nullptr);
+    }
+    const std::vector<std::uint8_t>& list = bufferSize_ > 0 ? merged : sparseList_;
+    const std::uint8_t* payload = sparse_ ? list.data() : registers_.Data();
+    const std::size_t payloadSize = sparse_ ? list.size() : registers_.ByteCount();
+
+    SketchHeader header{};
+    std::memcpy(header.magic, "HLLS", 4);
+    header.version = hll_detail::kFormatVersion;
+    header.hashBits = static_cast<std::uint8_t>(hashBits_);
+    header.indexBitCount = static_cast<std::uint8_t>(indexBitCount_);
+    header.encoding = sparse_ ? hll_detail::kEncodingSparse : hll_detail::kEncodingDensePacked6;
+    header.payloadSize = static_cast<std::uint32_t>(payloadSize);
+    header.hasherId = hasherId;
+    header.hashSeed = hashSeed;
+
+    const std::uint8_t* headerBytes = reinterpret_cast<const std::uint8_t*>(&header);
+    std::vector<std::uint8_t> bytes;
+    bytes.reserve(sizeof(header) + payloadSize);
+    bytes.insert(bytes.end(), headerBytes, headerBytes + sizeof(header));
+    bytes.insert(bytes.end(), payload, payload + payloadSize);
+    return bytes;
+  }
+
+  // Converts a sparse store to dense registers; no-op when already dense.
+  void ToDense() {
+    if (!sparse_) return;
+    Flush();
+    registers_ = PackedRegisters(indexBitCount_);
+    std::vector<std::uint8_t> list;
+    list.swap(sparseList_);
+    sparse_ = false;
+    MergeSparse(list.data(), list.size());
+    std::vector<SparseSkip>().swap(listSkips_);
+    std::vector<std::uint32_t>().swap(buffer_);
+    listCount_ = 0;
+    sparseCount_ = 0;
+  }
+
+private:
+  // Absolute key of every kSkipStride-th list entry and the byte offset of
+  // the entry after it.
+  struct SparseSkip {
+    std::uint32_t key;
+    std::uint32_t offset;
+  };
+
+  int indexBitCount_;
+  int hashBits_;
+  bool sparse_;
+  PackedRegisters registers_;
+  std::vector<std::uint8_t> sparseList_;
+  std::vector<SparseSkip> listSkips_;
+  // Open-addressing table of keys by sparse index, 0 for an empty slot (rho
+  // is at least 1, so no key is 0).
+  std::vector<std::uint32_t> buffer_;
+  std::size_t bufferSize_ = 0;
+  std::size_t listCount_ = 0;
+  // Distinct sparse indices in the list and the buffer together.
+  std::size_t sparseCount_ = 0;
+
+  std::uint32_t registerCount() const { return 1u << indexBitCount_; }
+
+  // Adds a sparse key in either mode; a dense store folds it into its register.
+  void AddSparseKey(std::uint32_t key) {
+    if (sparse_) {
+      InsertSparseKey(key);
+      return;
+    }
+    const std::uint32_t index = key >> 6;
+    registers_.SetMax(index & (registerCount() - 1u),
+                      hll_detail::FoldRegister(index, static_cast<std::uint8_t>(key & 63u), kSparseIndexBits,
+                                               indexBitCount_, hashBits_));
+  }
+
+  void InsertSparseKey(std::uint32_t key) {
+    if (buffer_.empty()) buffer_.assign(kMinBufferSlots, 0u);
+    const std::uint32_t index = key >> 6;
+    // Sparse indices are low hash bits, so they need no further mixing.
+    const std::size_t mask = buffer_.size() - 1;
+    std::size_t slot = index & mask;
+    while (buffer_[slot] != 0u) {
+      if ((buffer_[slot] >> 6) == index) {
+        buffer_[slot] = std::max(buffer_[slot], key);
+        return;
+      }
+      slot = (slot + 1) & mask;
+    }
+    buffer_[slot] = key;
+    ++bufferSize_;
+    if (!ListContains(index)) ++sparseCount_;
+
+    // At 3/4 load the table doubles if the sparse form still fits in the
+    // dense budget, so the list, which every flush rewrites, is rewritten as
+    // rarely as that budget allows. Otherwise the table is flushed and
+    // shrunk to fit next to the new list, or the store goes dense.
+    if (4 * bufferSize_ < 3 * buffer_.size()) return;
+    const std::size_t budget = PackedRegisters::MemoryUsage(indexBitCount_);
+    if (SparseMemoryUsage(2 * buffer_.size()) <= budget) {
+      Rehash(2 * buffer_.size());
+      return;
+    }
+    Flush();
+    std::size_t slots = buffer_.size();
+    while (slots > kMinBufferSlots && SparseMemoryUsage(slots) > budget) slots /= 2;
+    if (SparseMemoryUsage(slots) > budget) {
+      ToDense();
+    } else if (slots < buffer_.size()) {
+      std::vector<std::uint32_t>(slots, 0u).swap(buffer_);
+    }
+  }
+
+  // Heap bytes of the sparse form with a table of the given size.
+  std::size_t SparseMemoryUsage(std::size_t bufferSlots) const {
+    return sparseList_.capacity() + listSkips_.capacity() * sizeof(SparseSkip) +
+           bufferSlots * sizeof(std::uint32_t);
+  }
+
+  void Rehash(std::size_t capacity) {
+    std::vector<std::uint32_t> old(capacity, 0u);
+    old.swap(buffer_);
+    const std::size_t mask = capacity - 1;
+    for (std::uint32_t key : old) {
+      if (key == 0u) continue;
+      std::size_t slot = (key >> 6) & mask;
+      while (buffer_[slot] != 0u) slot = (slot + 1) & mask;
+      buffer_[slot] = key;
+    }
+  }
+
+  bool ListContains(std::uint32_t index) const {
+    auto after = std::upper_bound(listSkips_.begin(), listSkips_.end(), index,
+                                  [](std::uint32_t i, const SparseSkip& skip) { return i < (skip.key >> 6); });
+    if (after == listSkips_.begin()) return false;
+    const SparseSkip& skip = *(after - 1);
+    if ((skip.key >> 6) == index) return true;
+    std::uint32_t key = skip.key;
+    std::size_t pos = skip.offset;
+    for (std::size_t n = 1; n < kSkipStride && pos < sparseList_.size(); ++n) {
+      std::uint32_t delta = 0;
+      int shift = 0;
+      std::uint8_t byte;
+      do {
+        byte = sparseList_[pos++];
+        delta |= static_cast<std::uint32_t>(byte & 0x7Fu) << shift;
+        shift += 7;
+      } while (byte & 0x80u);
+      key += delta;
+      if ((key >> 6) >= index) return (key >> 6) == index;
+    }
+    return false;
+  }
+
+  std::vector<std::uint32_t> SortedBufferKeys() const {
+    std::vector<std::uint32_t> keys;
+    keys.reserve(bufferSize_);
+    for (std::uint32_t key : buffer_) {
+      if (key != 0u) keys.push_back(key);
+    }
+    std::sort(keys.begin(), keys.end());
+    return keys;
+  }
+
+  // Merges sorted keys into a compressed list, keeping the largest rho per
+  // sparse index, and optionally rebuilds the skip index. Returns the number
+  // of entries.
+  static std::size_t MergeIntoList(const std::vector<std::uint8_t>& list, const std::vector<std::uint32_t>& keys,
+                                   std::vector<std::uint8_t>& merged, std::vector<SparseSkip>* skips) {
+    merged.reserve(list.size() + keys.size() * 3);
+    if (skips != nullptr) skips->clear();
+    std::uint32_t previous = 0;
+    bool havePending = false;
+    std::uint32_t pending = 0;
+    std::size_t count = 0;
+    auto append = [&]() {
+      hll_detail::AppendVarint(merged, pending - previous);
+      previous = pending;
+      if (skips != nullptr && count % kSkipStride == 0) {
+        skips->push_back({pending, static_cast<std::uint32_t>(merged.size())});
+      }
+      ++count;
+    };
+    auto emit = [&](std::uint32_t key) {
+      if (havePending && (key >> 6) == (pending >> 6)) {
+        pending = std::max(pending, key);
+        return;
+      }
+      if (havePending) append();
+      pending = key;
+      havePending = true;
+    };
+
+    std::size_t next = 0;
+    hll_detail::ForEachSparseKey(list.data(), list.size(), [&](std::uint32_t key) {
+      while (next < keys.size() && keys[next] < key) emit(keys[next++]);
+      emit(key);
+    });
+    while (next < keys.size()) emit(keys[next++]);
+    if (havePending) append();
+    return count;
+  }
+
+  // Moves the buffered keys into the compressed list.
+  void Flush() {
+    if (bufferSize_ == 0) return;
+    std::vector<std::uint8_t> merged;
+    std::vector<SparseSkip> skips;
+    listCount_ = MergeIntoList(sparseList_, SortedBufferKeys(), merged, &skips);
+    // Exact capacities, as they count against the dense budget.
+    merged.shrink_to_fit();
+    skips.shrink_to_fit();
+    sparseList_.swap(merged);
+    listSkips_.swap(skips);
+    std::fill(buffer_.begin(), buffer_.end(), 0u);
+    bufferSize_ = 0;
+    sparseCount_ = listCount_;
+  }
+
+  void MergeSparse(const std::uint8_t* list, std::size_t size) {
+    hll_detail::ForEachSparseKey(list, size, [&](std::uint32_t key) { AddSparseKey(key); });
+  }
+
+  // Max-merges src registers (srcBits >= dstBits index bits) into dst;
+  // src(i) returns the i-th source register.
+  template <typename Source>
+  void MergeDense(PackedRegisters& dst, int dstBits, Source src, int srcBits) const {
+    const std::uint32_t srcCount = 1u << srcBits;
+    const std::uint32_t dstMask = (1u << dstBits) - 1u;
+    for (std::uint32_t i = 0; i < srcCount; ++i) {
+      const std::uint8_t reg = src(i);
+      if (reg == 0u) continue;
+      dst.SetMax(i & dstMask, srcBits == dstBits
+                                  ? reg
+                                  : hll_detail::FoldRegister(i, reg, srcBits, dstBits, hashBits_));
+    }
+  }
+
+  void MergeDense(PackedRegisters& dst, int dstBits, const PackedRegisters& src, int srcBits) const {
+    MergeDense(dst, dstBits, [&src](std::uint32_t i) { return src[i]; }, srcBits);
+  }
+};
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "RegisterStore.h"
+
+// Union, intersection, difference and Jaccard similarity of the sets behind
+// HyperLogLog sketches of one type, so of one hasher and precision. They
+// must also share the hash seed.
+//
+// InclusionExclusion derives everything from |A|, |B| and |A u B|. Its
+// intersection error scales with the union, so it is poor for small
+// overlaps. MaximumLikelihood fits |A \ B|, |B \ A| and |A n B| jointly
+// to the pairs of registers (Ertl, "New cardinality estimation methods for
+// HyperLogLog sketches", 2017) and is markedly more accurate there, at the
+// cost of a small numerical optimization per pair.
+enum class SetEstimator { InclusionExclusion, MaximumLikelihood };
+
+// Estimated sizes of the three disjoint parts of two sets.
+struct JointEstimate {
+  double onlyA;
+  double onlyB;
+  double both;
+
+  double Union() const { return onlyA + onlyB + both; }
+  // Two empty sets are identical, so their similarity is 1, as in
+  // AllPairsJaccard.
+  double Jaccard() const {
+    const double u = Union();
+    return u > 0.0 ? both / u : 1.0;
+  }
+};
+
+namespace set_detail {
+
+struct RegisterPair {
+  int a;
+  int b;
+  std::uint32_t count;
+};
+
+// P(register <= k) for a register fed by a Poisson number of items with
+// mean lambda; registers hold 0..q+1.
+inline double RegisterCdf(double lambda, int k, int q) {
+  if (k < 0) return 0.0;
+  if (k > q) return 1.0;
+  return std::exp(-lambda * std::ldexp(1.0, -k));
+}
+
+// Log-likelihood of the register pairs when each register independently
+// sees items only in A, only in B and in both at the mean rates lambda[0..2].
+// Register A is then max(only A, both) and register B max(only B, both).
+inline double JointLogLikelihood(const std::vector<RegisterPair>& pairs, const double* lambda, int q) {
+  auto joint = [lambda, q](int a, int b) {
+    return RegisterCdf(lambda[0], a, q) * RegisterCdf(lambda[1], b, q) *
+           RegisterCdf(lambda[2], std::min(a, b), q);
+  };
+  double logLikelihood = 0.0;
+  for (const RegisterPair& pair : pairs) {
+    const double p = joint(pair.a, pair.b) - joint(pair.a - 1, pair.b) - joint(pair.a, pair.b - 1) +
+                     joint(pair.a - 1, pair.b - 1);
+    logLikelihood += pair.count * std::log(std::max(p, 1e-300));
+  }
+  return logLikelihood;
+}
+
+// Maximizes JointLogLikelihood over log(lambda) with Nelder-Mead, starting
+// from start (per-register rates).
+inline std::array<double, 3> MaximizeJointLikelihood(const std::vector<RegisterPair>& pairs, int q,
+                                                     const std::array<double, 3>& start) {
+  using Point = std::array<double, 3>;
+  auto cost = [&pairs, q](const Point& u) {
+    const double lambda[3] = {std::exp(u[0]), std::exp(u[1]), std::exp(u[2])};
+    return -JointLogLikelihood(pairs, lambda, q);
+  };
+
+  std::array<Point, 4> simplex;
+  std::array<double, 4> value;
+  for (int i = 0; i < 4; ++i) {
+    for (int d = 0; d < 3; ++d) simplex[i][d] = std::log(start[d]) + (i == d + 1 ? 0.5 : 0.0);
+    value[i] = cost(simplex[i]);
+  }
+
+  for (int iteration = 0; iteration < 2000; ++iteration) {
+    std::array<int, 4> order = {0, 1, 2, 3};
+    std::sort(order.begin(), order.end(), [&value](int x, int y) { return value[x] < value[y]; });
+    const int best = order[0];
+    const int worst = order[3];
+    if (value[worst] - value[best] < 1e-10 * (1.0 + std::abs(value[best]))) break;
+
+    Point centroid{};
+    for (int i = 0; i < 3; ++i) {
+      for (int d = 0; d < 3; ++d) centroid[d] += simplex[order[i]][d] / 3.0;
+    }
+    auto along = [&](double t) {
+      Point p;
+      for (int d = 0; d < 3; ++d) p[d] = centroid[d] + t * (centroid[d] - simplex[worst][d]);
+      return p;
+    };
+
+    const Point reflected = along(1.0);
+    const double reflectedValue = cost(reflected);
+    if (reflectedValue < value[best]) {
+      const Point expanded = along(2.0);
+      const double expandedValue = cost(expanded);
+      const bool takeExpanded = expandedValue < reflectedValue;
+      simplex[worst] = takeExpanded ? expanded : reflected;
+      value[worst] = takeExpanded ? expandedValue : reflectedValue;
+    } else if (reflectedValue < value[order[2]]) {
+      simplex[worst] = reflected;
+      value[worst] = reflectedValue;
+    } else {
+      const Point contracted = along(-0.5);
+      const double contractedValue = cost(contracted);
+      if (contractedValue < value[worst]) {
+        simplex[worst] = contracted;
+        value[worst] = contractedValue;
+      } else {
+        for (int i = 1; i < 4; ++i) {
+          for (int d = 0; d < 3; ++d) {
+            simplex[order[i]][d] = simplex[best][d] + 0.5 * (simplex[order[i]][d] - simplex[best][d]);
+          }
+          value[order[i]] = cost(simplex[order[i]]);
+        }
+      }
+    }
+  }
+
+  const int best = static_cast<int>(std::min_element(value.begin(), value.end()) - value.begin());
+  return {std::exp(simplex[best][0]), std::exp(simplex[best][1]), std::exp(simplex[best][2])};
+}
+
+inline RegisterStore DenseCopy(const RegisterStore& store) {
+  RegisterStore copy = store;
+  if (copy.IsSparse()) copy.ToDense();
+  return copy;
+}
+
+}  // namespace set_detail
+
+template <typename Sketch>
+double UnionEstimate(const Sketch& a, const Sketch& b) {
+  Sketch merged = a;
+  merged.Merge(b);
+  return merged.Estimate();
+}
+
+template <typename Sketch>
+double UnionEstimate(const std::vector<Sketch>& sketches) {
+  if (sketches.empty()) return 0.0;
+  Sketch merged = sketches[0];
+  for (std::size_t i = 1; i < sketches.size(); ++i) merged.Merge(sketches[i]);
+  return merged.Estimate();
+}
+
+template <typename Sketch>
+JointEstimate EstimateJoint(const Sketch& a, const Sketch& b,
+                            SetEstimator estimator = SetEstimator::MaximumLikelihood) {
+  const double sizeA = a.Estimate();
+  const double sizeB = b.Estimate();
+  const double sizeUnion = UnionEstimate(a, b);
+  JointEstimate result{std::max(0.0, sizeUnion - sizeB), std::max(0.0, sizeUnion - sizeA),
+                       std::max(0.0, sizeA + sizeB - sizeUnion)};
+  // Two empty sketches have nothing to fit; the search would still settle
+  // on small positive rates.
+  if (estimator == SetEstimator::InclusionExclusion || sizeUnion == 0.0) return result;
+
+  const RegisterStore storeA = set_detail::DenseCopy(a.Registers());
+  const RegisterStore storeB = set_detail::DenseCopy(b.Registers());
+  const PackedRegisters& registersA = storeA.Registers();
+  const PackedRegisters& registersB = storeB.Registers();
+
+  std::vector<std::uint32_t> counts(64 * 64, 0);
+  for (std::uint32_t i = 0; i < registersA.Size(); ++i) ++counts[registersA[i] * 64 + registersB[i]];
+  std::vector<set_detail::RegisterPair> pairs;
+  for (int k = 0; k < 64 * 64; ++k) {
+    if (counts[k] != 0u) pairs.push_back({k / 64, k % 64, counts[k]});
+  }
+
+  // Start from inclusion-exclusion, kept away from zero so the search in
+  // log space can move every coordinate.
+  const double m = static_cast<double>(registersA.Size());
+  const double floor = 1e-3 * std::max(1.0, result.Union()) / m;
+  const std::array<double, 3> lambda = set_detail::MaximizeJointLikelihood(
+      pairs, Sketch::kHashBits - Sketch::kIndexBitCount,
+      {std::max(result.onlyA / m, floor), std::max(result.onlyB / m, floor), std::max(result.both / m, floor)});
+  return {lambda[0] * m, lambda[1] * m, lambda[2] * m};
+}
+
+template <typename Sketch>
+double IntersectionEstimate(const Sketch& a, const Sketch& b,
+                            SetEstimator estimator = SetEstimator::MaximumLikelihood) {
+  return EstimateJoint(a, b, estimator).both;
+}
+
+// |A \ B|.
+template <typename Sketch>
+double DifferenceEstimate(const Sketch& a, const Sketch& b,
+                          SetEstimator estimator = SetEstimator::MaximumLikelihood) {
+  return EstimateJoint(a, b, estimator).onlyA;
+}
+
+template <typename Sketch>
+double JaccardEstimate(const Sketch& a, const Sketch& b,
+                       SetEstimator estimator = SetEstimator::MaximumLikelihood) {
+  return EstimateJoint(a, b, estimator).Jaccard();
+}
+
+// Intersection of any number of sets by inclusion-exclusion over the unions
+// of all 2^k - 1 nonempty subsets, so k is limited to 16. The error grows
+// with every added set; for two sets prefer the pair overload.
+template <typename Sketch>
+double IntersectionEstimate(const std::vector<Sketch>& sketches) {
+  const std::size_t k = sketches.size();
+  if (k == 0) return 0.0;
+  if (k > 16) {
+    throw std::invalid_argument("inclusion-exclusion over more than 16 sketches");
+  }
+  double total = 0.0;
+  for (std::uint32_t subset = 1; subset < (1u << k); ++subset) {
+    const std::size_t first = static_cast<std::size_t>(__builtin_ctz(subset));
+    Sketch merged = sketches[first];
+    for (std::size_t i = first + 1; i < k; ++i) {
+      if (subset & (1u << i)) merged.Merge(sketches[i]);
+    }
+    total += (__builtin_popcount(subset) % 2 == 1 ? 1.0 : -1.0) * merged.Estimate();
+  }
+  return std::max(0.0, total);
+}
+
+// Jaccard similarity of every pair of sketches by inclusion-exclusion, as a
+// row-major n x n matrix with ones on the diagonal. All sketches must share
+// the hash seed. Union histograms are computed straight from
+// the packed registers, without building merged sketches, and rows are
+// spread over threads.
+template <typename Sketch>
+std::vector<double> AllPairsJaccard(const std::vector<Sketch>& sketches,
+                                    int threads = static_cast<int>(std::thread::hardware_concurrency())) {
+  const std::size_t n = sketches.size();
+  std::vector<RegisterStore> stores;
+  std::vector<double> sizes;
+  stores.reserve(n);
+  for (const Sketch& sketch : sketches) {
+    if (sketch.HashSeed() != sketches[0].HashSeed()) {
+      throw std::invalid_argument("all-pairs similarity needs sketches of one hash seed");
+    }
+    stores.push_back(set_detail::DenseCopy(sketch.Registers()));
+    sizes.push_back(Sketch::EstimateFromHistogram(stores.back().Registers().Histogram()));
+  }
+
+  std::vector<double> similarity(n * n, 1.0);
+  std::atomic<std::size_t> nextRow{0};
+  auto worker = [&]() {
+    for (std::size_t i = nextRow++; i < n; i = nextRow++) {
+      for (std::size_t j = i + 1; j < n; ++j) {
+        const double sizeUnion = Sketch::EstimateFromHistogram(
+            PackedRegisters::MaxHistogram(stores[i].Registers(), stores[j].Registers()));
+        const double both = std::max(0.0, sizes[i] + sizes[j] - sizeUnion);
+        const double jaccard = sizeUnion > 0.0 ? std::min(1.0, both / sizeUnion) : 1.0;
+        similarity[i * n + j] = jaccard;
+        similarity[j * n + i] = jaccard;
+      }
+    }
+  };
+
+  const int threadCount = std::max(1, std::min(threads, static_cast<int>(n)));
+  std::vector<std::thread> pool;
+  for (int t = 1; t < threadCount; ++t) pool.emplace_back(worker);
+  worker();
+  for (std::thread& thread : pool) thread.join();
+  return similarity;
+}
@@ -0,0 +1,96 @@
+// Accuracy and cost of the set estimators in SetOperations.h.
+//
+//   g++ -std=c++17 -O2 -pthread SetOperationsBenchmark.cpp -o set_operations_benchmark
+//   ./set_operations_benchmark [trials]
+//
+// Two sets of 100k distinct keys share a given number of them. Each trial
+// uses another hash seed; the columns are the mean relative error of the
+// intersection and of the Jaccard similarity against the true values, for
+// inclusion-exclusion ("IE") and maximum likelihood ("ML"), and the time
+// per EstimateJoint call. The last line times AllPairsJaccard on 50
+// sketches.
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "HyperLogLog.h"
+#include "SetOperations.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Sketch = HyperLogLogUltraMax<WyHash64, 12>;
+
+double Milliseconds(Clock::time_point begin, Clock::time_point end) {
+  return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+double RelativeError(double estimate, double truth) {
+  return std::abs(estimate - truth) / truth;
+}
+
+// Adds keys[first], ..., keys[first + count - 1].
+void AddRange(Sketch& sketch, const std::vector<std::string>& keys, std::size_t first, std::size_t count) {
+  for (std::size_t i = first; i < first + count; ++i) sketch.Add(keys[i]);
+}
+
+void Run(const std::vector<std::string>& keys, std::size_t setSize, std::size_t overlap, int trials) {
+  const double truthBoth = static_cast<double>(overlap);
+  const double truthJaccard = truthBoth / static_cast<double>(2 * setSize - overlap);
+  double intersectionError[2] = {0.0, 0.0};
+  double jaccardError[2] = {0.0, 0.0};
+  double milliseconds[2] = {0.0, 0.0};
+  const SetEstimator estimators[2] = {SetEstimator::InclusionExclusion, SetEstimator::MaximumLikelihood};
+
+  for (int trial = 0; trial < trials; ++trial) {
+    Sketch a(static_cast<std::uint64_t>(trial) + 1);
+    Sketch b(static_cast<std::uint64_t>(trial) + 1);
+    AddRange(a, keys, 0, setSize);
+    AddRange(b, keys, setSize - overlap, setSize);
+    for (int e = 0; e < 2; ++e) {
+      const auto begin = Clock::now();
+      const JointEstimate joint = EstimateJoint(a, b, estimators[e]);
+      milliseconds[e] += Milliseconds(begin, Clock::now());
+      intersectionError[e] += RelativeError(joint.both, truthBoth);
+      jaccardError[e] += RelativeError(joint.Jaccard(), truthJaccard);
+    }
+  }
+
+  std::printf("%-8zu %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", overlap, intersectionError[0] / trials,
+              intersectionError[1] / trials, jaccardError[0] / trials, jaccardError[1] / trials,
+              milliseconds[0] / trials, milliseconds[1] / trials);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int trials = argc > 1 ? std::atoi(argv[1]) : 20;
+  const std::size_t setSize = 100000;
+
+  std::vector<std::string> keys;
+  keys.reserve(2 * setSize);
+  for (std::size_t i = 0; i < 2 * setSize; ++i) keys.push_back("key" + std::to_string(i));
+
+  std::printf("p=%d, |A| = |B| = %zu, %d trials, mean relative error\n", Sketch::kIndexBitCount, setSize, trials);
+  std::printf("%-8s %10s %10s %10s %10s %10s %10s\n", "overlap", "n IE", "n ML", "J IE", "J ML", "IE ms",
+              "ML ms");
+  for (std::size_t overlap : {1000, 2000, 5000, 20000, 50000, 80000}) Run(keys, setSize, overlap, trials);
+
+  const std::size_t sketchCount = 50;
+  std::vector<Sketch> sketches;
+  for (std::size_t i = 0; i < sketchCount; ++i) {
+    sketches.emplace_back(1);
+    AddRange(sketches.back(), keys, i * (setSize / sketchCount), setSize);
+  }
+  const auto begin = Clock::now();
+  const std::vector<double> similarity = AllPairsJaccard(sketches);
+  std::printf("AllPairsJaccard, %zu sketches: %.1f ms (J[0][1] = %.3f)\n", sketchCount,
+              Milliseconds(begin, Clock::now()), similarity[1]);
+  return 0;
+}
@@ -0,0 +1,92 @@
+// Correctness and cost of SlidingHyperLogLog.
+//
+//   g++ -std=c++17 -O2 SlidingBenchmark.cpp -o sliding_benchmark
+//   ./sliding_benchmark [events]
+//
+// Events draw keys from a fixed pool, so they repeat, with ten events per
+// time unit. For several (window, now) queries the sliding estimate must
+// equal that of a plain HyperLogLog with the same hasher, precision and
+// estimator built from only the events inside the window; the last column
+// says whether it does. "exact" is the true distinct count of the window
+// and "error" the relative error of the estimate.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ExactCounter.h"
+#include "HyperLogLog.h"
+#include "RandomStreamGen.h"
+#include "SlidingHyperLogLog.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Event {
+  std::uint32_t key;
+  std::uint64_t timestamp;
+};
+
+template <int P>
+void Run(const std::vector<std::string>& pool, const std::vector<Event>& events, std::uint64_t maxWindow) {
+  using Sliding = SlidingHyperLogLog<WyHash64, P, ClassicEstimator>;
+  using Plain = HyperLogLog<WyHash64, P, Packed, ClassicEstimator>;
+  const std::uint64_t seed = 1;
+
+  Sliding sliding(seed, maxWindow);
+  const auto begin = Clock::now();
+  for (const Event& event : events) sliding.Add(pool[event.key], event.timestamp);
+  const double addNs =
+      std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / static_cast<double>(events.size());
+  std::printf("p=%d: %.1f ns per Add, %.1f MB\n", P, addNs, static_cast<double>(sliding.MemoryUsage()) / 1e6);
+
+  const std::uint64_t last = events.back().timestamp;
+  for (std::uint64_t now : {last, last + maxWindow / 200}) {
+    for (std::uint64_t window : {maxWindow / 100, maxWindow / 10, maxWindow / 2, maxWindow}) {
+      Plain plain(seed);
+      ExactDistinctCounter exact;
+      for (const Event& event : events) {
+        if (now - event.timestamp < window) {
+          plain.Add(pool[event.key]);
+          exact.Add(pool[event.key]);
+        }
+      }
+      const double estimate = sliding.Estimate(window, now);
+      const double truth = static_cast<double>(exact.Count());
+      std::printf("  %-12llu %-12llu %10zu %12.1f %+8.2f%%   %s\n", static_cast<unsigned long long>(window),
+                  static_cast<unsigned long long>(now), exact.Count(), estimate,
+                  truth > 0 ? 100.0 * (estimate - truth) / truth : 0.0,
+                  estimate == plain.Estimate() ? "identical" : "MISMATCH");
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::size_t eventCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+  const std::size_t poolSize = eventCount / 4;
+  const std::uint64_t eventsPerUnit = 10;
+  const std::uint64_t maxWindow = eventCount / eventsPerUnit / 2;
+
+  RandomStreamGen generator(13);
+  const std::vector<std::string> pool = generator.generate(poolSize);
+  std::mt19937_64 rng(17);
+  std::uniform_int_distribution<std::uint32_t> pick(0, static_cast<std::uint32_t>(poolSize - 1));
+  std::vector<Event> events(eventCount);
+  for (std::size_t i = 0; i < eventCount; ++i) events[i] = {pick(rng), i / eventsPerUnit};
+
+  std::printf("%zu events over %zu keys, maximal window %llu\n", eventCount, poolSize,
+              static_cast<unsigned long long>(maxWindow));
+  std::printf("  %-12s %-12s %10s %12s %9s\n", "window", "now", "exact", "estimate", "error");
+  Run<10>(pool, events, maxWindow);
+  Run<12>(pool, events, maxWindow);
+  Run<14>(pool, events, maxWindow);
+  return 0;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "Estimators.h"
+#include "HashFuncGen.h"
+#include "RegisterStore.h"
+
+// HyperLogLog over a sliding time window (Chabchoub and Hebrail's sliding
+// HyperLogLog). Instead of one rho, every register keeps its list of
+// future possible maxima: the (timestamp, rho) pairs that are still the
+// largest rho of some window ending now or later. A pair is dropped as soon
+// as a newer pair has a rho at least as large, or it falls out of the
+// maximal window. The list is therefore ordered by time with strictly
+// decreasing rho, holds at most kHashBits - p + 1 pairs, and an update is
+// amortized O(1).
+//
+// Estimate(window, now) counts the distinct items whose timestamp t
+// satisfies now - t < window, for any window up to maxWindow and any now
+// not before the last added timestamp. Timestamps are in caller-defined
+// units, must not decrease, and must stay below 2^56. The windowed registers
+// go through the same Estimator policies as HyperLogLog.
+template <typename Hasher = WyHash64, int Precision = 12, typename Estimator = ClassicEstimator>
+class SlidingHyperLogLog {
+  static_assert(Precision >= 4 && Precision <= 24, "precision must be in [4, 24]");
+
+public:
+  static constexpr int kHashBits = Hasher::kBits;
+  // Timestamps share a 64-bit entry with an 8-bit rho.
+  static constexpr std::uint64_t kTimestampLimit = std::uint64_t(1) << 56;
+
+  SlidingHyperLogLog(std::uint64_t hashSeed, std::uint64_t maxWindow)
+      : maxWindow_(maxWindow),
+        lists_(std::size_t(1) << Precision),
+        hasher_(hashSeed) {}
+
+  void Add(std::string_view value, std::uint64_t timestamp) {
+    if (timestamp < lastTimestamp_) {
+      throw std::invalid_argument("timestamps must not decrease");
+    }
+    if (timestamp >= kTimestampLimit) {
+      throw std::invalid_argument("timestamps must be below 2^56");
+    }
+    lastTimestamp_ = timestamp;
+
+    const std::uint64_t hash = hasher_(value);
+    const std::uint32_t index = static_cast<std::uint32_t>(hash) & (static_cast<std::uint32_t>(lists_.size()) - 1u);
+    const std::uint64_t rho = static_cast<std::uint64_t>(hll_detail::Rho(hash, Precision, kHashBits));
+
+    std::vector<std::uint64_t>& list = lists_[index];
+    while (!list.empty() && Rho(list.back()) <= rho) list.pop_back();
+    std::size_t expired = 0;
+    while (expired < list.size() && timestamp - Timestamp(list[expired]) >= maxWindow_) ++expired;
+    list.erase(list.begin(), list.begin() + static_cast<std::ptrdiff_t>(expired));
+    list.push_back((timestamp << 8) | rho);
+  }
+
+  double Estimate(std::uint64_t window, std::uint64_t now) const {
+    if (window > maxWindow_) {
+      throw std::invalid_argument("window is longer than the sketch's maximal window");
+    }
+    std::array<std::uint32_t, 64> histogram{};
+    for (const std::vector<std::uint64_t>& list : lists_) {
+      // The oldest pair inside the window has the largest rho.
+      std::uint64_t rho = 0;
+      for (std::uint64_t entry : list) {
+        if (now - Timestamp(entry) < window) {
+          rho = Rho(entry);
+          break;
+        }
+      }
+      ++histogram[rho];
+    }
+    return Estimator::template Estimate<Precision, kHashBits>(histogram);
+  }
+
+  int IndexBitCount() const { return Precision; }
+  std::uint64_t MaxWindow() const { return maxWindow_; }
+
+  std::size_t MemoryUsage() const {
+    std::size_t bytes = lists_.capacity() * sizeof(std::vector<std::uint64_t>);
+    for (const std::vector<std::uint64_t>& list : lists_) bytes += list.capacity() * sizeof(std::uint64_t);
+    return bytes;
+  }
+
+private:
+  std::uint64_t maxWindow_;
+  std::uint64_t lastTimestamp_ = 0;
+  // Per register, timestamp << 8 | rho, oldest first.
+  std::vector<std::vector<std::uint64_t>> lists_;
+  Hasher hasher_;
+
+  static std::uint64_t Timestamp(std::uint64_t entry) { return entry >> 8; }
+  static std::uint64_t Rho(std::uint64_t entry) { return entry & 0xFFu; }
+};